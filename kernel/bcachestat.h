@@ -0,0 +1,11 @@
+// Buffer cache statistics, returned by bcachestat().
+// Counts are since boot; sizes are in buffers.
+struct bcachestat {
+  uint64 hits;        // lookups that found the block cached
+  uint64 misses;      // lookups that had to read or claim a buffer
+  uint64 ghosthits;   // misses on blocks in the ghost list
+  uint64 evictions;   // misses that evicted a cached block
+  int nbuf;           // buffers in the cache
+  int nin;            // in the 2Q probationary queue
+  int nmain;          // in the 2Q main queue
+};
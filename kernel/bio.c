@@ -1,6 +1,6 @@
 // Buffer cache.
 //
-// The buffer cache is a linked list of buf structures holding
+// The buffer cache is a hash table of buf structures holding
 // cached copies of disk block contents.  Caching disk blocks
 // in memory reduces the number of disk reads and also provides
 // a synchronization point for disk blocks used by multiple processes.
@@ -8,6 +8,8 @@
 // Interface:
 // * To get a buffer for a particular disk block, call bread.
 // * After changing buffer data, call bwrite to write it to disk.
+// * To overlap I/O, call bread_async or bsubmit instead, and
+//     bwait before using the data or reusing the buffer.
 // * When done with the buffer, call brelse.
 // * Do not use the buffer after calling brelse.
 // * Only one process at a time can use a buffer,
@@ -22,33 +24,456 @@
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
+#include "bcachestat.h"
+
+// Buffers are kept in a hash table by (dev, blockno), so
+// lookups of different blocks rarely contend. The buckets
+// share NLOCK locks, bucket i using lock i % NLOCK. A
+// bucket's lock protects its chain and its bufs' dev,
+// blockno and refcnt fields; refcnt changes made without it
+// must be atomic, and may only be made by a holder of a
+// reference. The table doubles once the cache has more than
+// two bufs per bucket. bcache.lock serializes misses, which
+// evict, and changes to the cache's size and the table's,
+// so that two misses on the same block can't both install
+// it, and so that its holder may take more than one bucket
+// lock.
+//
+// The cache grows and shrinks a page at a time. Each page
+// holds the data of BPG bufs, whose headers form a bgroup.
+// When a miss finds no unused buf, bget() adds a group
+// rather than evicting, as long as the cache's pages number
+// fewer than 1/BGROWFRAC of the free pages; so the cache
+// settles well short of filling memory. kalloc() calls
+// bshrink() to take a group's page back if memory runs out
+// anyway. The cache never
+// shrinks below NBUF bufs. Group headers are carved from
+// pages of their own and never freed.
+//
+// Replacement follows 2Q, so that one big sequential read
+// can't flush hot metadata. A block read for the first time
+// goes on probation in the "in" queue, and stays there even
+// if it is hit again soon after. When an "in" buf is
+// evicted, its block number is remembered in the ghost
+// list; a miss on a remembered block means the block is
+// used again over a longer span, so it goes in the "main"
+// queue. Eviction takes a buf that holds nothing, if there
+// is one; else the oldest unreferenced buf of the "in"
+// queue while that queue holds more than a quarter of the
+// cache, else of the "main" queue. Each queue is a list
+// kept under bcache.lock, so that hits needn't take it; so
+// the "main" queue is a clock, not a true LRU list: a hit
+// sets b->ref, and eviction gives such a buf a second pass.
+#define NLOCK 64        // bucket locks; a power of two
+#define BPP (PGSIZE / sizeof(struct buf*))  // buckets per table page
+#define NTABLE 4096     // most table pages
+#define BHASH(dev, blockno) ((dev) * 31 + (blockno))
+#define BPG (PGSIZE / BSIZE)
+#define BGROWFRAC 4     // grow only while cache pages < free pages / this
+#define NGHOST 256      // block numbers remembered after eviction
+
+// which 2Q queue a buf is in.
+enum { BQ_FREE, BQ_IN, BQ_MAIN };
+
+struct bgroup {
+  struct buf buf[BPG];
+  uchar *page;            // the bufs' data
+  struct bgroup *next;    // in bcache.groups or bcache.spare
+};
 
 struct {
   struct spinlock lock;
-  struct buf buf[NBUF];
 
-  // Linked list of all buffers, through prev/next.
-  // head.next is most recently used.
-  struct buf head;
+  struct spinlock bucketlock[NLOCK];
+  // bucket i is table[i / BPP][i % BPP], a chain through
+  // next/prev, and nbucket is a power of two, at least NLOCK.
+  struct buf **table[NTABLE];
+  int nbucket;
+
+  struct bgroup *groups;  // groups with pages
+  struct bgroup *spare;   // groups whose pages bshrink() took
+  char *slab;             // rest of the page groups come from
+  char *slabend;
+  int nbuf;               // bufs with pages
+
+  // 2Q bookkeeping, under bcache.lock. each queue is a
+  // circular list through lnext/lprev, oldest first; unused
+  // bufs are in BQ_FREE, and in no bucket.
+  struct buf *q[3];
+  int nq[3];              // bufs in each queue
+  struct {
+    uint dev;
+    uint blockno;
+  } ghost[NGHOST];        // a FIFO ring; dev ~0 if unused
+  int ghostnext;
+
+  // statistics for bcachestat().
+  struct {
+    uint64 n;
+    char pad[64 - sizeof(uint64)];  // own cache line
+  } hits[NCPU];           // by the CPU that hit
+  uint64 misses;
+  uint64 ghosthits;
+  uint64 evictions;
 } bcache;
 
+// The lock of the bucket holding block blockno of dev.
+static struct spinlock*
+bucketlock(uint dev, uint blockno)
+{
+  return &bcache.bucketlock[BHASH(dev, blockno) % NLOCK];
+}
+
+// The bucket holding block blockno of dev.
+// Caller must hold its lock, which keeps the table's size
+// from changing.
+static struct buf**
+bucket(uint dev, uint blockno)
+{
+  uint i = BHASH(dev, blockno) & (bcache.nbucket - 1);
+
+  return &bcache.table[i / BPP][i % BPP];
+}
+
+// Insert b at the front of its bucket's chain.
+// Caller must hold the bucket's lock.
+static void
+binsert(struct buf *b)
+{
+  struct buf **bp = bucket(b->dev, b->blockno);
+
+  b->next = *bp;
+  b->prev = 0;
+  if(*bp)
+    (*bp)->prev = b;
+  *bp = b;
+}
+
+// Remove b from its bucket's chain.
+// Caller must hold the bucket's lock.
+static void
+bremove(struct buf *b)
+{
+  if(b->next)
+    b->next->prev = b->prev;
+  if(b->prev)
+    b->prev->next = b->next;
+  else
+    *bucket(b->dev, b->blockno) = b->next;
+}
+
+// Add b at the back of queue b->queue.
+// Caller must hold bcache.lock.
+static void
+qappend(struct buf *b)
+{
+  struct buf **q = &bcache.q[b->queue];
+
+  if(*q == 0){
+    b->lnext = b->lprev = b;
+    *q = b;
+  } else {
+    b->lnext = *q;
+    b->lprev = (*q)->lprev;
+    b->lprev->lnext = b;
+    (*q)->lprev = b;
+  }
+  bcache.nq[b->queue]++;
+}
+
+// Take b out of queue b->queue.
+// Caller must hold bcache.lock.
+static void
+qremove(struct buf *b)
+{
+  struct buf **q = &bcache.q[b->queue];
+
+  if(b->lnext == b){
+    *q = 0;
+  } else {
+    b->lprev->lnext = b->lnext;
+    b->lnext->lprev = b->lprev;
+    if(*q == b)
+      *q = b->lnext;
+  }
+  bcache.nq[b->queue]--;
+}
+
+// Double the hash table, so that its chains stay short as
+// the cache grows. Caller must hold bcache.lock.
+static void
+brehash(void)
+{
+  int i, n, npage, h;
+  struct buf *b, *next, **bp, *chain;
+
+  n = bcache.nbucket;
+  npage = n / BPP;
+  if(2 * npage > NTABLE)
+    return;
+  for(i = npage; i < 2 * npage; i++){
+    if((bcache.table[i] = kalloc()) == 0){
+      while(--i >= npage)
+        kfree(bcache.table[i]);
+      return;
+    }
+    memset(bcache.table[i], 0, PGSIZE);
+  }
+
+  for(h = 0; h < NLOCK; h++)
+    acquire(&bcache.bucketlock[h]);
+  // each chain splits between bucket i and bucket i + n.
+  bcache.nbucket = 2 * n;
+  for(i = 0; i < n; i++){
+    bp = &bcache.table[i / BPP][i % BPP];
+    chain = *bp;
+    *bp = 0;
+    for(b = chain; b; b = next){
+      next = b->next;
+      binsert(b);
+    }
+  }
+  for(h = 0; h < NLOCK; h++)
+    release(&bcache.bucketlock[h]);
+}
+
+// Add BPG unused bufs to the cache.
+// Caller must hold bcache.lock.
+// Returns 0 if out of memory.
+static int
+bgrow(void)
+{
+  struct bgroup *g;
+  struct buf *b;
+  uchar *page;
+
+  if((page = kalloc()) == 0)
+    return 0;
+  if((g = bcache.spare) != 0){
+    bcache.spare = g->next;
+  } else {
+    if(bcache.slab + sizeof(struct bgroup) > bcache.slabend){
+      if((bcache.slab = kalloc()) == 0){
+        kfree(page);
+        return 0;
+      }
+      bcache.slabend = bcache.slab + PGSIZE;
+    }
+    g = (struct bgroup*)bcache.slab;
+    bcache.slab += sizeof(struct bgroup);
+    for(b = g->buf; b < &g->buf[BPG]; b++)
+      initsleeplock(&b->lock, "buffer");
+  }
+
+  g->page = page;
+  for(b = g->buf; b < &g->buf[BPG]; b++){
+    b->data = page + (b - g->buf) * BSIZE;
+    b->dev = b->blockno = ~0;  // no such block
+    b->valid = 0;
+    b->disk = 0;
+    b->done = 0;
+    b->refcnt = 0;
+    b->ref = 0;
+    b->timestamp = 0;
+    b->queue = BQ_FREE;
+    qappend(b);
+  }
+  g->next = bcache.groups;
+  bcache.groups = g;
+  bcache.nbuf += BPG;
+
+  if(bcache.nbuf > 2 * bcache.nbucket)
+    brehash();
+  return 1;
+}
+
+// Give one group's page back to kalloc(), if the cache is
+// above its minimum size and some group's bufs are all
+// unreferenced; prefers the least recently used such group.
+// Called by kalloc() when it has no free pages.
+// Returns 1 if it freed a page.
+int
+bshrink(void)
+{
+  struct bgroup *g, **pg, **best;
+  struct buf *b;
+  uint newest, bestnewest = 0;
+  int h;
+
+  // bget() is the one allocating.
+  if(holding(&bcache.lock))
+    return 0;
+
+  acquire(&bcache.lock);
+  if(bcache.nbuf - BPG < NBUF){
+    release(&bcache.lock);
+    return 0;
+  }
+  for(h = 0; h < NLOCK; h++)
+    acquire(&bcache.bucketlock[h]);
+
+  best = 0;
+  for(pg = &bcache.groups; (g = *pg) != 0; pg = &g->next){
+    newest = 0;
+    for(b = g->buf; b < &g->buf[BPG]; b++){
+      if(b->refcnt != 0)
+        break;
+      if(b->timestamp > newest)
+        newest = b->timestamp;
+    }
+    if(b == &g->buf[BPG] && (best == 0 || newest < bestnewest)){
+      best = pg;
+      bestnewest = newest;
+    }
+  }
+  if(best){
+    g = *best;
+    *best = g->next;
+    for(b = g->buf; b < &g->buf[BPG]; b++){
+      if(b->queue != BQ_FREE)
+        bremove(b);
+      qremove(b);
+    }
+    bcache.nbuf -= BPG;
+  }
+
+  for(h = 0; h < NLOCK; h++)
+    release(&bcache.bucketlock[h]);
+  if(best){
+    g->next = bcache.spare;
+    bcache.spare = g;
+  }
+  release(&bcache.lock);
+
+  if(best == 0)
+    return 0;
+  kfree(g->page);
+  g->page = 0;
+  return 1;
+}
+
 void
 binit(void)
 {
-  struct buf *b;
+  int h;
 
   initlock(&bcache.lock, "bcache");
+  for(h = 0; h < NLOCK; h++)
+    initlock(&bcache.bucketlock[h], "bcache.bucket");
+
+  for(h = 0; h < NGHOST; h++)
+    bcache.ghost[h].dev = ~0;
+
+  if((bcache.table[0] = kalloc()) == 0)
+    panic("binit");
+  memset(bcache.table[0], 0, PGSIZE);
+  bcache.nbucket = BPP;
+
+  acquire(&bcache.lock);
+  while(bcache.nbuf < NBUF)
+    if(bgrow() == 0)
+      panic("binit");
+  release(&bcache.lock);
+}
+
+// Look for block blockno of dev in its bucket. If found,
+// take a reference to it and return it.
+// Caller must hold the bucket's lock.
+static struct buf*
+blookup(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  for(b = *bucket(dev, blockno); b; b = b->next){
+    if(b->dev == dev && b->blockno == blockno){
+      __sync_fetch_and_add(&b->refcnt, 1);
+      b->ref = 1;
+      bcache.hits[cpuid()].n++;  // interrupts are off
+      return b;
+    }
+  }
+  return 0;
+}
+
+// Is block blockno of dev in the ghost list? If so, forget it.
+// Caller must hold bcache.lock.
+static int
+bghost(uint dev, uint blockno)
+{
+  int i;
+
+  for(i = 0; i < NGHOST; i++){
+    if(bcache.ghost[i].dev == dev && bcache.ghost[i].blockno == blockno){
+      bcache.ghost[i].dev = ~0;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Find the oldest unreferenced buf in queue q, moving the
+// bufs it passes over to the back: those in use, and "main"
+// bufs hit since their last pass, whose b->ref it clears.
+// Returns the buf, still in the queue, with its bucket's
+// lock held; or 0 if there is none.
+// Caller must hold bcache.lock.
+static struct buf*
+bclock(int q)
+{
+  struct buf *b;
+  int i;
+
+  // two passes: the first may only clear b->ref.
+  for(i = 0; i < 2 * bcache.nq[q]; i++){
+    b = bcache.q[q];
+    bcache.q[q] = b->lnext;
+    if(b->refcnt != 0)
+      continue;  // unlocked peek; checked again below
+    if(q == BQ_MAIN && b->ref){
+      b->ref = 0;
+      continue;
+    }
+    acquire(bucketlock(b->dev, b->blockno));
+    if(b->refcnt == 0)
+      return b;
+    release(bucketlock(b->dev, b->blockno));
+  }
+  return 0;
+}
+
+// Take the buf that 2Q evicts first out of the cache and
+// return it, unreferenced and in no queue or bucket, with
+// its old block remembered in the ghost list if it was in
+// the "in" queue; or 0 if every buf is in use.
+// Caller must hold bcache.lock.
+static struct buf*
+bvictim(void)
+{
+  struct buf *b;
+  int first = BQ_MAIN, second = BQ_IN;
+
+  if((b = bcache.q[BQ_FREE]) != 0){
+    qremove(b);
+    return b;
+  }
+
+  if(bcache.nq[BQ_IN] > bcache.nbuf / 4){
+    first = BQ_IN;
+    second = BQ_MAIN;
+  }
+  if((b = bclock(first)) == 0 && (b = bclock(second)) == 0)
+    return 0;
+  bremove(b);
+  release(bucketlock(b->dev, b->blockno));
+  qremove(b);
 
-  // Create linked list of buffers
-  bcache.head.prev = &bcache.head;
-  bcache.head.next = &bcache.head;
-  for(b = bcache.buf; b < bcache.buf+NBUF; b++){
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    initsleeplock(&b->lock, "buffer");
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+  if(b->queue == BQ_IN){
+    bcache.ghost[bcache.ghostnext].dev = b->dev;
+    bcache.ghost[bcache.ghostnext].blockno = b->blockno;
+    bcache.ghostnext = (bcache.ghostnext + 1) % NGHOST;
   }
+  bcache.evictions++;
+  return b;
 }
 
 // Look through buffer cache for block on device dev.
@@ -58,32 +483,76 @@ static struct buf*
 bget(uint dev, uint blockno)
 {
   struct buf *b;
+  struct spinlock *lk = bucketlock(dev, blockno);
 
+  // Is the block already cached?
+  acquire(lk);
+  b = blookup(dev, blockno);
+  release(lk);
+  if(b){
+    acquiresleep(&b->lock);
+    return b;
+  }
+
+  // Not cached. Look again once we're the only evictor,
+  // since another process may have cached it meanwhile.
   acquire(&bcache.lock);
+  acquire(lk);
+  b = blookup(dev, blockno);
+  release(lk);
+  if(b){
+    release(&bcache.lock);
+    acquiresleep(&b->lock);
+    return b;
+  }
 
-  // Is the block already cached?
-  for(b = bcache.head.next; b != &bcache.head; b = b->next){
-    if(b->dev == dev && b->blockno == blockno){
-      b->refcnt++;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
-    }
+  // Use an unused buffer if there is one; else grow, while
+  // the cache is small next to free memory; else recycle
+  // the buffer 2Q picks.
+  if(bcache.q[BQ_FREE] == 0 && bcache.nbuf / BPG < kfreepages() / BGROWFRAC)
+    bgrow();
+  if((b = bvictim()) == 0){
+    if(bgrow() == 0 || (b = bvictim()) == 0)
+      panic("bget: no buffers");
   }
 
-  // Not cached; recycle an unused buffer.
-  for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
-    if(b->refcnt == 0) {
-      b->dev = dev;
-      b->blockno = blockno;
-      b->valid = 0;
-      b->refcnt = 1;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
-    }
+  // a ghost is promoted.
+  bcache.misses++;
+  if(bghost(dev, blockno)){
+    bcache.ghosthits++;
+    b->queue = BQ_MAIN;
+  } else {
+    b->queue = BQ_IN;
   }
-  panic("bget: no buffers");
+  qappend(b);
+
+  // no other process can find b until it's in the bucket.
+  b->dev = dev;
+  b->blockno = blockno;
+  b->valid = 0;
+  b->refcnt = 1;
+  b->ref = 0;
+  acquire(lk);
+  binsert(b);
+  release(lk);
+  release(&bcache.lock);
+  acquiresleep(&b->lock);
+  return b;
+}
+
+// Return a locked buf for the indicated block, having started
+// a read of its contents if they aren't cached, but without
+// waiting for the read; call bwait() before using the data.
+struct buf*
+bread_async(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno);
+  // bprefetch() may already be reading it.
+  if(!b->valid && !b->disk)
+    iosched_submit(b, 0, 0);
+  return b;
 }
 
 // Return a locked buf with the contents of the indicated block.
@@ -92,25 +561,75 @@ bread(uint dev, uint blockno)
 {
   struct buf *b;
 
+  b = bread_async(dev, blockno);
+  bwait(b);
+  return b;
+}
+
+// Called by the disk driver when a bprefetch() read is done,
+// once it has cleared b->done.
+static void
+bprefetched(struct buf *b)
+{
+  bunpin(b);
+}
+
+// Start reading the indicated block into the cache, if it
+// isn't there, without waiting for the read to finish.
+// A later bread() of the block waits for it.
+// Returns -1 if too much I/O is already queued.
+int
+bprefetch(uint dev, uint blockno)
+{
+  struct buf *b;
+
   b = bget(dev, blockno);
-  if(!b->valid) {
-    virtio_disk_rw(b->dev, b, 0);
-    b->valid = 1;
+  if(b->valid || b->disk){
+    brelse(b);
+    return 0;
   }
-  return b;
+  // the disk keeps our reference until the read is done,
+  // so b can't be recycled while the read is in flight.
+  b->done = bprefetched;
+  if(iosched_submit(b, 0, 1) < 0){
+    b->done = 0;
+    brelse(b);
+    return -1;
+  }
+  b->timestamp = ticks;
+  releasesleep(&b->lock);
+  return 0;
+}
+
+// Start writing b's contents to disk, without waiting for
+// the write to finish. Must be locked, and stay locked until
+// bwait() says the write is done.
+void
+bsubmit(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bsubmit");
+  iosched_submit(b, 1, 0);
+}
+
+// Wait for I/O started on b to finish. The caller can do
+// nothing until it does, so poll for a while before sleeping.
+void
+bwait(struct buf *b)
+{
+  virtio_disk_wait(b->dev, b, 1);
 }
 
 // Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
 {
-  if(!holdingsleep(&b->lock))
-    panic("bwrite");
-  virtio_disk_rw(b->dev, b, 1);
+  bsubmit(b);
+  bwait(b);
 }
 
 // Release a locked buffer.
-// Move to the head of the MRU list.
+// Its timestamp makes it the most recently used.
 void
 brelse(struct buf *b)
 {
@@ -119,33 +638,37 @@ brelse(struct buf *b)
 
   releasesleep(&b->lock);
 
-  acquire(&bcache.lock);
-  b->refcnt--;
-  if (b->refcnt == 0) {
-    // no one is waiting for it.
-    b->next->prev = b->prev;
-    b->prev->next = b->next;
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
-  }
-  
-  release(&bcache.lock);
+  b->timestamp = ticks;
+  __sync_fetch_and_sub(&b->refcnt, 1);
 }
 
 void
 bpin(struct buf *b) {
-  acquire(&bcache.lock);
-  b->refcnt++;
-  release(&bcache.lock);
+  __sync_fetch_and_add(&b->refcnt, 1);
 }
 
 void
 bunpin(struct buf *b) {
-  acquire(&bcache.lock);
-  b->refcnt--;
-  release(&bcache.lock);
+  __sync_fetch_and_sub(&b->refcnt, 1);
 }
 
+// Copy buffer cache statistics to user address addr.
+int
+bcachestat(uint64 addr)
+{
+  struct bcachestat bs;
+  int i;
 
+  memset(&bs, 0, sizeof(bs));
+  for(i = 0; i < NCPU; i++)
+    bs.hits += bcache.hits[i].n;
+  acquire(&bcache.lock);
+  bs.misses = bcache.misses;
+  bs.ghosthits = bcache.ghosthits;
+  bs.evictions = bcache.evictions;
+  bs.nbuf = bcache.nbuf;
+  bs.nin = bcache.nq[BQ_IN];
+  bs.nmain = bcache.nq[BQ_MAIN];
+  release(&bcache.lock);
+  return either_copyout(1, addr, &bs, sizeof(bs));
+}
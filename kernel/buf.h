@@ -1,13 +1,22 @@
 struct buf {
   int valid;   // has data been read from disk?
   int disk;    // does disk "own" buf?
+  int write;   // is the disk's I/O a write?
+  int vq;      // virtqueue the disk's I/O goes through
+  uint deadline; // ticks by which iosched.c should dispatch it
+  void (*done)(struct buf*);  // if set, called when disk is done
   uint dev;
   uint blockno;
   struct sleeplock lock;
   uint refcnt;
-  struct buf *prev; // LRU cache list
+  uint timestamp;   // ticks when last released, for LRU eviction
+  int queue;        // 2Q queue; see bio.c
+  int ref;          // hit since eviction last passed it?
+  struct buf *lprev; // 2Q queue list
+  struct buf *lnext;
+  struct buf *prev; // hash bucket chain
   struct buf *next;
-  struct buf *qnext; // disk queue
-  uchar data[BSIZE];
+  struct buf *qnext; // iosched.c queue, then virtio request
+  uchar *data;      // BSIZE bytes, in a page shared with other bufs
 };
 
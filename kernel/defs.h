@@ -1,21 +1,31 @@
 struct buf;
 struct context;
 struct file;
+struct fpstate;
 struct inode;
+struct lockclass;
 struct pipe;
 struct proc;
+struct rwlock;
 struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct timepage;
 
 // bio.c
 void            binit(void);
 struct buf*     bread(uint, uint);
+struct buf*     bread_async(uint, uint);
+int             bprefetch(uint, uint);
+void            bsubmit(struct buf*);
+void            bwait(struct buf*);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
+int             bshrink(void);
+int             bcachestat(uint64);
 
 // console.c
 void            consoleinit(void);
@@ -37,6 +47,7 @@ int             filewrite(struct file*, uint64, int n);
 // fs.c
 void            fsinit(int);
 int             dirlink(struct inode*, char*, uint);
+int             fstrim(int);
 struct inode*   dirlookup(struct inode*, char*, uint*);
 struct inode*   ialloc(uint, short);
 struct inode*   idup(struct inode*);
@@ -58,8 +69,14 @@ void            ramdiskinit(void);
 void            ramdiskintr(void);
 void            ramdiskrw(struct buf*);
 
+// iosched.c
+void            iosched_init(void);
+int             iosched_submit(struct buf*, int, int);
+void            iosched_kick(int, int);
+
 // kalloc.c
 void*           kalloc(void);
+int             kfreepages(void);
 void            kfree(void *);
 void            kinit();
 
@@ -69,6 +86,12 @@ void            log_write(struct buf*);
 void            begin_op(int);
 void            end_op(int);
 void            crash_op(int,int);
+void            log_sync(int);
+void            flusher(void);
+void            log_trim(int, uint);
+void            log_untrim(int, uint);
+void            begin_quiet(int);
+void            end_quiet(int);
 
 // pipe.c
 int             pipealloc(struct file**, struct file**);
@@ -83,12 +106,18 @@ void            printfinit(void);
 
 // proc.c
 int             cpuid(void);
-void            exit(void);
+void            exit(int);
 int             fork(void);
+void            fpflush(struct proc*);
 int             growproc(int);
 pagetable_t     proc_pagetable(struct proc *);
 void            proc_freepagetable(pagetable_t, uint64);
 int             kill(int);
+void            kthread(char*, void (*)(void));
+int             setaffinity(int, uint64);
+int             getaffinity(int, uint64*);
+int             getprocinfo(uint64, int);
+int             getrusage(uint64);
 struct cpu*     mycpu(void);
 struct cpu*     getmycpu(void);
 struct proc*    myproc();
@@ -98,9 +127,9 @@ void            sched(void);
 void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
-int             wait(void);
 void            wakeup(void*);
 void            yield(void);
+int             waitpid(int, uint64, int);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
@@ -108,11 +137,16 @@ void            procdump(void);
 // swtch.S
 void            swtch(struct context*, struct context*);
 
+// fp.S
+void            fpsave(struct fpstate*);
+void            fprestore(struct fpstate*);
+
 // spinlock.c
 void            acquire(struct spinlock*);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
+int             tryacquire(struct spinlock*);
 void            push_off(void);
 void            pop_off(void);
 uint64          sys_ntas(void);
@@ -123,6 +157,26 @@ void            releasesleep(struct sleeplock*);
 int             holdingsleep(struct sleeplock*);
 void            initsleeplock(struct sleeplock*, char*);
 
+// rwlock.c
+void            initrwlock(struct rwlock*, char*);
+void            acquireread(struct rwlock*);
+void            releaseread(struct rwlock*);
+void            acquirewrite(struct rwlock*);
+void            releasewrite(struct rwlock*);
+
+// lockstat.c
+struct lockclass* lockclass(char*, int);
+void            lockstat_acquired(struct lockclass*, uint64);
+void            lockstat_released(struct lockclass*, uint64);
+int             lockstat(uint64, int);
+
+// rcu.c
+void            rcu_read_lock(void);
+void            rcu_read_unlock(void);
+uint64          rcu_retire(void);
+int             rcu_done(uint64);
+void            rcu_wait(uint64);
+
 // string.c
 int             memcmp(const void*, const void*, uint);
 void*           memmove(void*, const void*, uint);
@@ -142,10 +196,17 @@ void            syscall();
 
 // trap.c
 extern uint     ticks;
+extern struct timepage *timepage;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
 void            usertrapret(void);
+void            sendipi(int, int);
+void            ipiintr(void);
+void            tlbshootdown(void);
+
+// start.c
+int             timerfired(void);
 
 // uart.c
 void            uartinit(void);
@@ -181,7 +242,11 @@ void            plic_complete(int);
 
 // virtio_disk.c
 void            virtio_disk_init(int);
-void            virtio_disk_rw(int, struct buf *, int);
+int             virtio_disk_issue(int, int, struct buf *, int, int);
+int             virtio_disk_nqueue(int);
+int             virtio_disk_discard(int, uint, uint);
+int             virtio_disk_flush(int);
+void            virtio_disk_wait(int, struct buf *, int);
 void            virtio_disk_intr(int);
 
 // number of elements in fixed-size array
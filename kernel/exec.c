@@ -111,6 +111,7 @@ exec(char *path, char **argv)
   p->sz = sz;
   p->tf->epc = elf.entry;  // initial program counter = main
   p->tf->sp = sp; // initial stack pointer
+  p->fpused = 0;  // FP unit off until the new image uses it
   proc_freepagetable(oldpagetable, oldsz);
   return argc; // this ends up in a0, the first argument to main(argc, argv)
 
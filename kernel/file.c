@@ -44,14 +44,13 @@ filealloc(void)
 }
 
 // Increment ref count for file f.
+// The caller's reference keeps f allocated,
+// so ftable.lock isn't needed.
 struct file*
 filedup(struct file *f)
 {
-  acquire(&ftable.lock);
-  if(f->ref < 1)
+  if(__sync_fetch_and_add(&f->ref, 1) < 1)
     panic("filedup");
-  f->ref++;
-  release(&ftable.lock);
   return f;
 }
 
@@ -60,11 +59,17 @@ void
 fileclose(struct file *f)
 {
   struct file ff;
+  int ref;
+
+  // Not the last reference: just drop it.
+  while((ref = f->ref) > 1)
+    if(__sync_bool_compare_and_swap(&f->ref, ref, ref - 1))
+      return;
 
   acquire(&ftable.lock);
   if(f->ref < 1)
     panic("fileclose");
-  if(--f->ref > 0){
+  if(__sync_sub_and_fetch(&f->ref, 1) > 0){
     release(&ftable.lock);
     return;
   }
@@ -27,6 +27,10 @@ struct inode {
   short nlink;
   uint size;
   uint addrs[NDIRECT+1];
+
+  uint raoff;         // offset just past the last readi()
+  uint rawin;         // read-ahead window, in blocks; 0 if random
+  uint raend;         // first block not yet read ahead
 };
 
 // map major device number to device functions.
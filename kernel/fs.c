@@ -15,6 +15,7 @@
 #include "param.h"
 #include "stat.h"
 #include "spinlock.h"
+#include "rwlock.h"
 #include "proc.h"
 #include "sleeplock.h"
 #include "fs.h"
@@ -22,6 +23,7 @@
 #include "file.h"
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
 static void itrunc(struct inode*);
 // there should be one superblock per disk device, but we run with
 // only one device
@@ -77,6 +79,7 @@ balloc(uint dev)
         bp->data[bi/8] |= m;  // Mark block in use.
         log_write(bp);
         brelse(bp);
+        log_untrim(dev, b + bi);
         bzero(dev, b + bi);
         return b + bi;
       }
@@ -101,6 +104,49 @@ bfree(int dev, uint b)
   bp->data[bi/8] &= ~m;
   log_write(bp);
   brelse(bp);
+  log_trim(dev, b);
+}
+
+// Discard every free block of dev, for the fstrim() system
+// call, a run of consecutive free blocks at a time.
+// Returns how many blocks it discarded, -1 if the disk
+// failed a discard, or -2 if the disk can't discard.
+int
+fstrim(int dev)
+{
+  int b, bi, start, n, r;
+  struct buf *bp;
+
+  begin_quiet(dev);
+  n = 0;
+  start = -1;
+  for(b = 0; b < sb.size && n >= 0; b += BPB){
+    bp = bread(dev, BBLOCK(b, sb));
+    for(bi = 0; bi < BPB && b + bi < sb.size; bi++){
+      if((bp->data[bi/8] & (1 << (bi % 8))) == 0){  // Is block free?
+        if(start < 0)
+          start = b + bi;
+        continue;
+      }
+      if(start >= 0){
+        if((r = virtio_disk_discard(dev, start, b + bi - start)) < 0){
+          n = r;
+          break;
+        }
+        n += b + bi - start;
+        start = -1;
+      }
+    }
+    brelse(bp);
+  }
+  if(start >= 0 && n >= 0){
+    if((r = virtio_disk_discard(dev, start, sb.size - start)) < 0)
+      n = r;
+    else
+      n += sb.size - start;
+  }
+  end_quiet(dev);
+  return n;
 }
 
 // Inodes.
@@ -163,17 +209,21 @@ bfree(int dev, uint b)
 // have locked the inodes involved; this lets callers create
 // multi-step atomic operations.
 //
-// The icache.lock spin-lock protects the allocation of icache
-// entries. Since ip->ref indicates whether an entry is free,
+// The icache.lock reader-writer lock protects the allocation of
+// icache entries. Since ip->ref indicates whether an entry is free,
 // and ip->dev and ip->inum indicate which i-node an entry
 // holds, one must hold icache.lock while using any of those fields.
+// A read hold suffices to find a cached inode, so lookups run in
+// parallel; changes to ip->ref under a read hold, or by a holder
+// of a reference, must be atomic. Recycling an entry, and taking
+// the last reference away, need the write hold.
 //
 // An ip->lock sleep-lock protects all ip-> fields other than ref,
 // dev, and inum.  One must hold ip->lock in order to
 // read or write that inode's ip->valid, ip->size, ip->type, &c.
 
 struct {
-  struct spinlock lock;
+  struct rwlock lock;
   struct inode inode[NINODE];
 } icache;
 
@@ -182,7 +232,7 @@ iinit()
 {
   int i = 0;
   
-  initlock(&icache.lock, "icache");
+  initrwlock(&icache.lock, "icache");
   for(i = 0; i < NINODE; i++) {
     initsleeplock(&icache.inode[i].lock, "inode");
   }
@@ -245,14 +295,25 @@ iget(uint dev, uint inum)
 {
   struct inode *ip, *empty;
 
-  acquire(&icache.lock);
-
   // Is the inode already cached?
+  acquireread(&icache.lock);
+  for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
+    if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
+      __sync_fetch_and_add(&ip->ref, 1);
+      releaseread(&icache.lock);
+      return ip;
+    }
+  }
+  releaseread(&icache.lock);
+
+  // Not cached. Look again with the write hold, since
+  // another process may have added it meanwhile.
+  acquirewrite(&icache.lock);
   empty = 0;
   for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
     if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
-      ip->ref++;
-      release(&icache.lock);
+      __sync_fetch_and_add(&ip->ref, 1);
+      releasewrite(&icache.lock);
       return ip;
     }
     if(empty == 0 && ip->ref == 0)    // Remember empty slot.
@@ -268,19 +329,19 @@ iget(uint dev, uint inum)
   ip->inum = inum;
   ip->ref = 1;
   ip->valid = 0;
-  release(&icache.lock);
+  releasewrite(&icache.lock);
 
   return ip;
 }
 
 // Increment reference count for ip.
 // Returns ip to enable ip = idup(ip1) idiom.
+// The caller's own reference keeps ip from being
+// recycled, so no lock is needed.
 struct inode*
 idup(struct inode *ip)
 {
-  acquire(&icache.lock);
-  ip->ref++;
-  release(&icache.lock);
+  __sync_fetch_and_add(&ip->ref, 1);
   return ip;
 }
 
@@ -307,6 +368,7 @@ ilock(struct inode *ip)
     ip->size = dip->size;
     memmove(ip->addrs, dip->addrs, sizeof(ip->addrs));
     brelse(bp);
+    ip->raoff = ip->rawin = ip->raend = 0;
     ip->valid = 1;
     if(ip->type == 0)
       panic("ilock: no type");
@@ -333,7 +395,14 @@ iunlock(struct inode *ip)
 void
 iput(struct inode *ip)
 {
-  acquire(&icache.lock);
+  int ref;
+
+  // Not the last reference: just drop it.
+  while((ref = ip->ref) > 1)
+    if(__sync_bool_compare_and_swap(&ip->ref, ref, ref - 1))
+      return;
+
+  acquirewrite(&icache.lock);
 
   if(ip->ref == 1 && ip->valid && ip->nlink == 0){
     // inode has no links and no other references: truncate and free.
@@ -342,7 +411,7 @@ iput(struct inode *ip)
     // so this acquiresleep() won't block (or deadlock).
     acquiresleep(&ip->lock);
 
-    release(&icache.lock);
+    releasewrite(&icache.lock);
 
     itrunc(ip);
     ip->type = 0;
@@ -351,11 +420,11 @@ iput(struct inode *ip)
 
     releasesleep(&ip->lock);
 
-    acquire(&icache.lock);
+    acquirewrite(&icache.lock);
   }
 
-  ip->ref--;
-  release(&icache.lock);
+  __sync_fetch_and_sub(&ip->ref, 1);
+  releasewrite(&icache.lock);
 }
 
 // Common idiom: unlock, then put.
@@ -437,6 +506,7 @@ itrunc(struct inode *ip)
   }
 
   ip->size = 0;
+  ip->raoff = ip->rawin = ip->raend = 0;
   iupdate(ip);
 }
 
@@ -452,6 +522,43 @@ stati(struct inode *ip, struct stat *st)
   st->size = ip->size;
 }
 
+// Read-ahead window limits, in blocks.
+#define RAMIN 4
+#define RAMAX 64
+
+// Start reading the blocks of [off, off+n) and those that a
+// sequential reader of ip will want next, without waiting,
+// so that the reads overlap. A read that starts where the last one stopped is
+// sequential; each one that has used up half of what was
+// read ahead doubles the window, up to RAMAX, and tops it
+// up. Any other read turns read-ahead off until the reads
+// are sequential again.
+// Caller must hold ip->lock.
+static void
+readahead(struct inode *ip, uint off, uint n)
+{
+  uint bn, end, nblocks;
+
+  if(off != ip->raoff){
+    ip->rawin = 0;
+    ip->raend = 0;
+    return;
+  }
+
+  end = (off + n + BSIZE - 1) / BSIZE;  // first block past this read
+  if(ip->raend > end + ip->rawin / 2)
+    return;  // plenty is already on its way
+  ip->rawin = ip->rawin ? min(2 * ip->rawin, RAMAX) : RAMIN;
+
+  nblocks = (ip->size + BSIZE - 1) / BSIZE;
+  bn = max(ip->raend, off / BSIZE);
+  for(; bn < end + ip->rawin && bn < nblocks; bn++){
+    if(bprefetch(ip->dev, bmap(ip, bn)) < 0)
+      break;  // disk queue is full; try again next time
+  }
+  ip->raend = bn;
+}
+
 // Read data from inode.
 // Caller must hold ip->lock.
 // If user_dst==1, then dst is a user virtual address;
@@ -467,6 +574,10 @@ readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
   if(off + n > ip->size)
     n = ip->size - off;
 
+  if(ip->type == T_FILE)
+    readahead(ip, off, n);
+  ip->raoff = off + n;
+
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
@@ -0,0 +1,166 @@
+// Block I/O scheduler.
+//
+// bio.c submits each read or write here rather than to the
+// disk driver. Requests wait in a queue, sorted by block
+// number, until the driver has descriptors free; then runs
+// of queued requests for consecutive blocks in the same
+// direction go to the disk as one request. Each of a disk's
+// virtqueues has its own queue here, and a hart submits to
+// the queue for its hart group, so that harts doing I/O at
+// once don't contend for locks.
+//
+// Dispatch order is C-LOOK: the lowest queued block at or
+// after the block just past the last dispatch, wrapping
+// around to the lowest queued block. A request that has
+// waited past its deadline goes first, so that a stream of
+// requests at higher blocks can't starve it; reads, which
+// someone is usually waiting for, get shorter deadlines
+// than writes.
+
+#include "types.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "riscv.h"
+#include "defs.h"
+#include "fs.h"
+#include "buf.h"
+#include "virtio.h"
+
+#define RDEADLINE 5    // ticks a read may wait in the queue
+#define WDEADLINE 50   // ticks a write may wait in the queue
+#define MAXMERGE  32   // most blocks in one request
+#define NQUEUED   64   // iosched_submit(..., 1) fails past this
+
+struct ioqueue {
+  struct spinlock lock;
+  struct buf *head;   // queued bufs, by blockno, through qnext
+  int n;              // how many
+  uint pos;           // block just past the last dispatch
+} ioq[NDISK][NVQ];
+
+void
+iosched_init(void)
+{
+  for(int n = 0; n < NDISK; n++)
+    for(int q = 0; q < NVQ; q++)
+      initlock(&ioq[n][q].lock, "ioq");
+}
+
+// Choose the next buf to dispatch from queue iq,
+// returning the link that points to it.
+// Caller must hold iq->lock, and the queue must not be empty.
+static struct buf**
+pick(struct ioqueue *iq)
+{
+  struct buf **pb, **oldest, **next;
+
+  oldest = next = 0;
+  for(pb = &iq->head; *pb; pb = &(*pb)->qnext){
+    if(oldest == 0 || (int)((*pb)->deadline - (*oldest)->deadline) < 0)
+      oldest = pb;
+    if(next == 0 && (*pb)->blockno >= iq->pos)
+      next = pb;
+  }
+  if((int)(ticks - (*oldest)->deadline) >= 0)
+    return oldest;
+  if(next == 0)
+    next = &iq->head;  // wrap around
+  return next;
+}
+
+// Hand requests queued for virtqueue q of disk n to the
+// disk while it has room.
+// Caller must hold ioq[n][q].lock.
+static void
+dispatch(int n, int q)
+{
+  struct ioqueue *iq = &ioq[n][q];
+  struct buf **pb, *b, *run[MAXMERGE];
+  int nb, issued, write;
+  uint blockno;
+
+  while(iq->head){
+    pb = pick(iq);
+    b = *pb;
+    write = b->write;
+    blockno = b->blockno;
+
+    // merge the run of consecutive blocks that follows.
+    run[0] = b;
+    for(nb = 1; nb < MAXMERGE; nb++){
+      b = run[nb-1]->qnext;
+      if(b == 0 || b->blockno != run[nb-1]->blockno + 1 || b->write != write)
+        break;
+      run[nb] = b;
+    }
+
+    // unlink the run before issuing it: once issued, a buf
+    // may complete on another hart, and be reused and queued
+    // again, before virtio_disk_issue() returns.
+    *pb = run[nb-1]->qnext;
+    run[nb-1]->qnext = 0;
+    iq->n -= nb;
+
+    issued = virtio_disk_issue(n, q, run[0], nb, write);
+
+    // put back the bufs the disk had no room for.
+    if(issued < nb){
+      run[nb-1]->qnext = *pb;
+      *pb = run[issued];
+      iq->n += nb - issued;
+    }
+    if(issued == 0)
+      break;  // virtio_disk_intr() will call iosched_kick()
+    iq->pos = blockno + issued;
+  }
+}
+
+// Queue I/O on locked buf b: read it from disk, or write it
+// to disk if write is set; virtio_disk_wait() waits for it.
+// Returns -1, having queued nothing, if nowait is set and
+// the queue is already long.
+int
+iosched_submit(struct buf *b, int write, int nowait)
+{
+  struct ioqueue *iq;
+  struct buf **pb;
+  int n = b->dev, q;
+
+  // the queue for this hart's group. if the process moves to
+  // another hart, the queue is still right, if not the best.
+  push_off();
+  q = cpuid() % virtio_disk_nqueue(n);
+  pop_off();
+  iq = &ioq[n][q];
+
+  acquire(&iq->lock);
+  if(nowait && iq->n >= NQUEUED){
+    release(&iq->lock);
+    return -1;
+  }
+
+  b->disk = 1;
+  b->write = write;
+  b->vq = q;
+  b->deadline = ticks + (write ? WDEADLINE : RDEADLINE);
+  for(pb = &iq->head; *pb && (*pb)->blockno < b->blockno; pb = &(*pb)->qnext)
+    ;
+  b->qnext = *pb;
+  *pb = b;
+  iq->n++;
+
+  dispatch(n, q);
+  release(&iq->lock);
+  return 0;
+}
+
+// Virtqueue q of disk n has finished requests, so may have
+// room for more.
+void
+iosched_kick(int n, int q)
+{
+  acquire(&ioq[n][q].lock);
+  dispatch(n, q);
+  release(&ioq[n][q].lock);
+}
@@ -0,0 +1,156 @@
+// Lock statistics.
+//
+// Every lock with the same name and type shares a lockclass,
+// found by initlock() or initsleeplock(). Each CPU counts in
+// its own slot of the class, so the counters need no atomics:
+// a CPU updates its slot only with interrupts off, holding
+// the lock being counted.
+//
+// Built only with -DLOCKSTAT; otherwise lockstat() fails.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "spinlock.h"
+#include "riscv.h"
+#include "proc.h"
+#include "defs.h"
+#include "lockstat.h"
+
+#ifdef LOCKSTAT
+
+#define NLOCKCLASS 64
+
+struct lockclass {
+  char *name;
+  int type;
+  struct {
+    uint64 nacquire;
+    uint64 ncontended;
+    uint64 nspin;
+    uint64 holdtotal;
+    uint64 holdmax;
+    char pad[24];     // one cache line per CPU
+  } cpu[NCPU];
+};
+
+// classlock has no class of its own, since initlock()
+// needs it to find one; it is never counted.
+static struct spinlock classlock;
+static struct lockclass classes[NLOCKCLASS];
+// lockstat() sums the classes into one page.
+_Static_assert(NLOCKCLASS * sizeof(struct lockinfo) <= PGSIZE, "NLOCKCLASS");
+static int nclass;
+
+// Find or create the class for locks called name.
+// Returns 0 if there are too many names; such locks
+// aren't counted.
+struct lockclass*
+lockclass(char *name, int type)
+{
+  struct lockclass *c;
+
+  acquire(&classlock);
+  for(c = classes; c < &classes[nclass]; c++)
+    if(c->type == type && strncmp(c->name, name, 16) == 0)
+      goto out;
+  if(nclass == NLOCKCLASS){
+    c = 0;
+    goto out;
+  }
+  c = &classes[nclass++];
+  c->name = name;
+  c->type = type;
+out:
+  release(&classlock);
+  return c;
+}
+
+// Count an acquisition that spun (or slept) n times first.
+void
+lockstat_acquired(struct lockclass *c, uint64 n)
+{
+  if(c == 0)
+    return;
+  c->cpu[cpuid()].nacquire++;
+  if(n > 0){
+    c->cpu[cpuid()].ncontended++;
+    c->cpu[cpuid()].nspin += n;
+  }
+}
+
+// Count a hold that lasted t.
+void
+lockstat_released(struct lockclass *c, uint64 t)
+{
+  if(c == 0)
+    return;
+  c->cpu[cpuid()].holdtotal += t;
+  if(t > c->cpu[cpuid()].holdmax)
+    c->cpu[cpuid()].holdmax = t;
+}
+
+// Sum c's per-CPU counters into li.
+static void
+lockstat_sum(struct lockclass *c, struct lockinfo *li)
+{
+  memset(li, 0, sizeof(*li));
+  safestrcpy(li->name, c->name, sizeof(li->name));
+  li->type = c->type;
+  for(int i = 0; i < NCPU; i++){
+    li->nacquire += c->cpu[i].nacquire;
+    li->ncontended += c->cpu[i].ncontended;
+    li->nspin += c->cpu[i].nspin;
+    li->holdtotal += c->cpu[i].holdtotal;
+    if(c->cpu[i].holdmax > li->holdmax)
+      li->holdmax = c->cpu[i].holdmax;
+  }
+}
+
+// Copy out up to n struct lockinfos to user address addr,
+// most contended first. Returns the number copied.
+// The counters are read without locks, so they may be
+// slightly inconsistent with each other.
+int
+lockstat(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct lockinfo *sum;
+  char done[NLOCKCLASS];
+  int i, j, best, m, k;
+
+  if((sum = (struct lockinfo*)kalloc()) == 0)
+    return -1;
+  acquire(&classlock);
+  m = nclass;
+  release(&classlock);
+  for(i = 0; i < m; i++){
+    lockstat_sum(&classes[i], &sum[i]);
+    done[i] = 0;
+  }
+
+  for(k = 0; k < n && k < m; k++){
+    best = -1;
+    for(j = 0; j < m; j++)
+      if(!done[j] && (best < 0 || sum[j].ncontended > sum[best].ncontended))
+        best = j;
+    done[best] = 1;
+    if(copyout(p->pagetable, addr + k*sizeof(struct lockinfo),
+               (char*)&sum[best], sizeof(struct lockinfo)) < 0){
+      kfree((char*)sum);
+      return -1;
+    }
+  }
+  kfree((char*)sum);
+  return k;
+}
+
+#else
+
+int
+lockstat(uint64 addr, int n)
+{
+  return -1;
+}
+
+#endif
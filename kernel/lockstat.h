@@ -0,0 +1,14 @@
+// Lock contention statistics, returned by lockstat().
+// The kernel keeps them per lock name, when built with LOCKSTAT.
+#define LS_SPIN   1  // spinlock
+#define LS_SLEEP  2  // sleeplock
+
+struct lockinfo {
+  char name[16];
+  int type;           // LS_SPIN or LS_SLEEP
+  uint64 nacquire;    // acquisitions
+  uint64 ncontended;  // acquisitions that had to wait
+  uint64 nspin;       // spin loops (spinlocks), or spins and sleeps (sleeplocks)
+  uint64 holdtotal;   // time held: cycles for spinlocks,
+  uint64 holdmax;     // CLINT mtime units for sleeplocks
+};
@@ -21,6 +21,20 @@
 // But if it thinks the log is close to running out, it
 // sleeps until the last outstanding end_op() commits.
 //
+// Commits are delayed, so that a transaction collects the
+// updates of many system calls, and a block they write
+// again and again is written to disk only once. The last
+// outstanding end_op() commits only once the transaction
+// is COMMITAGE ticks old or has COMMITBLOCKS blocks; the
+// flusher thread commits old transactions that no end_op()
+// comes along to commit. log_sync() commits at once, for
+// fsync() and sync().
+//
+// Blocks that a transaction frees are discarded, so that the
+// disk can unmap them, once it commits; not before, since a
+// crash would leave them allocated, and blocks allocated
+// again in the same transaction are kept.
+//
 // The log is a physical re-do log containing disk blocks.
 // The on-disk log format:
 //   header block, containing block #s for block A, B, C, ...
@@ -28,7 +42,13 @@
 //   block B
 //   block C
 //   ...
-// Log appends are synchronous.
+//
+// The disk may cache writes, so each step of a commit ends
+// with a flush, a barrier: the log blocks are durable before
+// the header that commits them, the header before the home
+// locations are written, and those before the header is
+// erased. Within a step, all the writes go to the disk at
+// once.
 
 // Contents of the header block, used for both the on-disk header block
 // and to keep track in memory of logged block# before commit.
@@ -43,8 +63,13 @@ struct log {
   int size;
   int outstanding; // how many FS sys calls are executing.
   int committing;  // in commit(), please wait.
+  int wantcommit;  // commit once outstanding ops end; start no more.
+  uint opened;     // ticks when the transaction logged its first block.
+  int ncommit;     // how many commits have finished.
   int dev;
   struct logheader lh;
+  int ntrim;        // blocks freed by the open transaction,
+  uint trim[NTRIM]; // to discard once it commits.
 };
 struct log log[NDISK];
 
@@ -59,26 +84,43 @@ initlog(int dev, struct superblock *sb)
 
   initlock(&log[dev].lock, "log");
   log[dev].start = sb->logstart;
-  log[dev].size = sb->nlog;
   log[dev].dev = dev;
   recover_from_log(dev);
+  // only now may flusher() and log_sync() commit; until
+  // then, the recovered header isn't theirs.
+  __sync_synchronize();
+  log[dev].size = sb->nlog;
 }
 
-// Copy committed blocks from log to their home location
+// Copy committed blocks from log to their home location,
+// and flush. Log blocks are still cached after a commit, and
+// home blocks are pinned; recovery reads them all at once.
 static void
-install_trans(int dev)
+install_trans(int dev, int recovering)
 {
   int tail;
+  struct buf *lbuf[LOGSIZE], *dbuf[LOGSIZE];
 
+  if (log[dev].lh.n == 0)
+    return;
+  for (tail = 0; tail < log[dev].lh.n; tail++) {
+    lbuf[tail] = bread_async(dev, log[dev].start+tail+1); // read log block
+    dbuf[tail] = bread_async(dev, log[dev].lh.block[tail]); // read dst
+  }
+  for (tail = 0; tail < log[dev].lh.n; tail++) {
+    bwait(lbuf[tail]);
+    bwait(dbuf[tail]);
+    memmove(dbuf[tail]->data, lbuf[tail]->data, BSIZE);  // copy block to dst
+    bsubmit(dbuf[tail]);  // write dst to disk
+    brelse(lbuf[tail]);
+  }
   for (tail = 0; tail < log[dev].lh.n; tail++) {
-    struct buf *lbuf = bread(dev, log[dev].start+tail+1); // read log block
-    struct buf *dbuf = bread(dev, log[dev].lh.block[tail]); // read dst
-    memmove(dbuf->data, lbuf->data, BSIZE);  // copy block to dst
-    bwrite(dbuf);  // write dst to disk
-    bunpin(dbuf);
-    brelse(lbuf);
-    brelse(dbuf);
+    bwait(dbuf[tail]);
+    if (!recovering)
+      bunpin(dbuf[tail]);
+    brelse(dbuf[tail]);
   }
+  virtio_disk_flush(dev);
 }
 
 // Read the log header from disk into the in-memory log header
@@ -95,7 +137,7 @@ read_head(int dev)
   brelse(buf);
 }
 
-// Write in-memory log header to disk.
+// Write in-memory log header to disk, and flush.
 // This is the true point at which the
 // current transaction commits.
 static void
@@ -110,17 +152,75 @@ write_head(int dev)
   }
   bwrite(buf);
   brelse(buf);
+  virtio_disk_flush(dev);
 }
 
 static void
 recover_from_log(int dev)
 {
   read_head(dev);
-  install_trans(dev); // if committed, copy from log to disk
+  install_trans(dev, 1); // if committed, copy from log to disk
   log[dev].lh.n = 0;
   write_head(dev); // clear the log
 }
 
+// Should the open transaction be committed now?
+// Caller must hold log[dev].lock.
+static int
+commitdue(int dev)
+{
+  return log[dev].lh.n > 0 &&
+    (log[dev].wantcommit || log[dev].lh.n >= COMMITBLOCKS ||
+     ticks - log[dev].opened >= COMMITAGE);
+}
+
+// Commit the open transaction.
+// Caller must hold log[dev].lock, and no FS system
+// calls may be executing.
+static void
+commit_locked(int dev)
+{
+  log[dev].committing = 1;
+  // call commit w/o holding locks, since not allowed
+  // to sleep with locks.
+  release(&log[dev].lock);
+  commit(dev);
+  acquire(&log[dev].lock);
+  log[dev].committing = 0;
+  log[dev].wantcommit = 0;
+  log[dev].ncommit++;
+  wakeup(&log);
+}
+
+// Wait until no FS system calls are executing and commit,
+// then keep new ones from starting until end_quiet(), so
+// that the caller sees a committed file system that
+// doesn't change.
+void
+begin_quiet(int dev)
+{
+  acquire(&log[dev].lock);
+  while(log[dev].committing || log[dev].outstanding > 0){
+    if(!log[dev].committing)
+      log[dev].wantcommit = 1;  // start no more
+    sleep(&log, &log[dev].lock);
+  }
+  log[dev].committing = 1;
+  release(&log[dev].lock);
+  commit(dev);
+}
+
+void
+end_quiet(int dev)
+{
+  acquire(&log[dev].lock);
+  log[dev].committing = 0;
+  log[dev].wantcommit = 0;
+  log[dev].ncommit++;
+  wakeup(&log);
+  release(&log[dev].lock);
+}
+
 // called at the start of each FS system call.
 void
 begin_op(int dev)
@@ -129,9 +229,14 @@ begin_op(int dev)
   while(1){
     if(log[dev].committing){
       sleep(&log, &log[dev].lock);
+    } else if(log[dev].wantcommit){
+      if(log[dev].outstanding == 0)
+        commit_locked(dev);
+      else
+        sleep(&log, &log[dev].lock);
     } else if(log[dev].lh.n + (log[dev].outstanding+1)*MAXOPBLOCKS > LOGSIZE){
-      // this op might exhaust log space; wait for commit.
-      sleep(&log, &log[dev].lock);
+      // this op might exhaust log space; commit first.
+      log[dev].wantcommit = 1;
     } else {
       log[dev].outstanding += 1;
       release(&log[dev].lock);
@@ -141,19 +246,17 @@ begin_op(int dev)
 }
 
 // called at the end of each FS system call.
-// commits if this was the last outstanding operation.
+// commits if this was the last outstanding operation
+// and the transaction is due.
 void
 end_op(int dev)
 {
-  int do_commit = 0;
-
   acquire(&log[dev].lock);
   log[dev].outstanding -= 1;
   if(log[dev].committing)
     panic("log[dev].committing");
-  if(log[dev].outstanding == 0){
-    do_commit = 1;
-    log[dev].committing = 1;
+  if(log[dev].outstanding == 0 && commitdue(dev)){
+    commit_locked(dev);
   } else {
     // begin_op() may be waiting for log space,
     // and decrementing log[dev].outstanding has decreased
@@ -161,44 +264,142 @@ end_op(int dev)
     wakeup(&log);
   }
   release(&log[dev].lock);
+}
 
-  if(do_commit){
-    // call commit w/o holding locks, since not allowed
-    // to sleep with locks.
-    commit(dev);
-    acquire(&log[dev].lock);
-    log[dev].committing = 0;
-    wakeup(&log);
+// Commit the updates of every FS system call that has
+// finished, and wait until they are on disk.
+void
+log_sync(int dev)
+{
+  int n;
+
+  if(log[dev].size == 0)
+    return;  // no file system on this disk
+  acquire(&log[dev].lock);
+  if(log[dev].lh.n == 0 && !log[dev].committing){
     release(&log[dev].lock);
+    return;
   }
+  // an ongoing commit has everything that had finished
+  // when it started, since begin_op() waits for commits.
+  n = log[dev].ncommit;
+  if(!log[dev].committing && log[dev].outstanding == 0){
+    commit_locked(dev);
+  } else {
+    if(!log[dev].committing)
+      log[dev].wantcommit = 1;
+    while(log[dev].ncommit == n)
+      sleep(&log, &log[dev].lock);
+  }
+  release(&log[dev].lock);
 }
 
-// Copy modified blocks from cache to log.
+// Kernel thread that commits transactions once they are
+// COMMITAGE ticks old, in case no end_op() does.
+void
+flusher(void)
+{
+  int dev;
+  uint t0;
+
+  for(;;){
+    acquire(&tickslock);
+    t0 = ticks;
+    while(ticks - t0 < COMMITAGE / 2)
+      sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    for(dev = 0; dev < NDISK; dev++){
+      if(log[dev].size == 0)
+        continue;  // no file system on this disk
+      acquire(&log[dev].lock);
+      if(!log[dev].committing && commitdue(dev)){
+        if(log[dev].outstanding == 0)
+          commit_locked(dev);
+        else
+          log[dev].wantcommit = 1;
+      }
+      release(&log[dev].lock);
+    }
+  }
+}
+
+// Copy modified blocks from cache to log, and flush.
 static void
 write_log(int dev)
 {
   int tail;
+  struct buf *to[LOGSIZE];
 
+  // start all the writes, then wait for them all,
+  // so the disk can work on several at once.
+  for (tail = 0; tail < log[dev].lh.n; tail++)
+    to[tail] = bread_async(dev, log[dev].start+tail+1); // log block
   for (tail = 0; tail < log[dev].lh.n; tail++) {
-    struct buf *to = bread(dev, log[dev].start+tail+1); // log block
     struct buf *from = bread(dev, log[dev].lh.block[tail]); // cache block
-    memmove(to->data, from->data, BSIZE);
-    bwrite(to);  // write the log
+    bwait(to[tail]);
+    memmove(to[tail]->data, from->data, BSIZE);
+    bsubmit(to[tail]);  // write the log
     brelse(from);
-    brelse(to);
   }
+  for (tail = 0; tail < log[dev].lh.n; tail++) {
+    bwait(to[tail]);
+    brelse(to[tail]);
+  }
+  virtio_disk_flush(dev);
+}
+
+// Sort the logged block numbers, so that install_trans()
+// writes home locations in disk order.
+static void
+sort_log(int dev)
+{
+  int i, j, b;
+
+  for(i = 1; i < log[dev].lh.n; i++){
+    b = log[dev].lh.block[i];
+    for(j = i; j > 0 && log[dev].lh.block[j-1] > b; j--)
+      log[dev].lh.block[j] = log[dev].lh.block[j-1];
+    log[dev].lh.block[j] = b;
+  }
+}
+
+// Discard the blocks the committed transaction freed,
+// a run of consecutive blocks at a time.
+static void
+trim_freed(int dev)
+{
+  int i, j;
+  uint b, *t = log[dev].trim;
+
+  for(i = 1; i < log[dev].ntrim; i++){
+    b = t[i];
+    for(j = i; j > 0 && t[j-1] > b; j--)
+      t[j] = t[j-1];
+    t[j] = b;
+  }
+  for(i = 0; i < log[dev].ntrim; i = j){
+    for(j = i + 1; j < log[dev].ntrim && t[j] == t[j-1] + 1; j++)
+      ;
+    if(virtio_disk_discard(dev, t[i], j - i) < 0)
+      break;  // the disk can't discard
+  }
+  log[dev].ntrim = 0;
 }
 
 static void
 commit(int dev)
 {
   if (log[dev].lh.n > 0) {
+    sort_log(dev);
     write_log(dev);     // Write modified blocks from cache to log
     write_head(dev);    // Write header to disk -- the real commit
-    install_trans(dev); // Now install writes to home locations
+    install_trans(dev, 0); // Now install writes to home locations
     log[dev].lh.n = 0;
     write_head(dev);    // Erase the transaction from the log
   }
+  if (log[dev].ntrim > 0)
+    trim_freed(dev);
 }
 
 // Caller has modified b->data and is done with the buffer.
@@ -229,11 +430,43 @@ log_write(struct buf *b)
   log[dev].lh.block[i] = b->blockno;
   if (i == log[dev].lh.n) {  // Add new block to log?
     bpin(b);
+    if(log[dev].lh.n == 0)
+      log[dev].opened = ticks;
     log[dev].lh.n++;
   }
   release(&log[dev].lock);
 }
 
+// Caller has freed block b in the open transaction;
+// discard it once the transaction commits. If too many
+// blocks are freed, the rest are left for fstrim().
+void
+log_trim(int dev, uint b)
+{
+  acquire(&log[dev].lock);
+  if(log[dev].ntrim < NTRIM)
+    log[dev].trim[log[dev].ntrim++] = b;
+  release(&log[dev].lock);
+}
+
+// Caller has allocated block b in the open transaction;
+// it may have been freed earlier in the transaction, and
+// mustn't be discarded.
+void
+log_untrim(int dev, uint b)
+{
+  int i;
+
+  acquire(&log[dev].lock);
+  for(i = 0; i < log[dev].ntrim; i++){
+    if(log[dev].trim[i] == b){
+      log[dev].trim[i] = log[dev].trim[--log[dev].ntrim];
+      break;
+    }
+  }
+  release(&log[dev].lock);
+}
+
 // crash before commit or after commit
 void
 crash_op(int dev, int docommit)
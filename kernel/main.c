@@ -29,10 +29,12 @@ main()
     plicinit();      // set up interrupt controller
     plicinithart();  // ask PLIC for device interrupts
     binit();         // buffer cache
+    iosched_init();  // block I/O queues
     iinit();         // inode cache
     fileinit();      // file table
     virtio_disk_init(minor(ROOTDEV)); // emulated hard disk
     userinit();      // first user process
+    kthread("flusher", flusher); // commits delayed log transactions
     __sync_synchronize();
     started = 1;
   } else {
@@ -1,4 +1,4 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC       512  // maximum number of processes
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
@@ -9,6 +9,9 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
+#define COMMITAGE    30  // commit a log transaction once this many ticks old
+#define COMMITBLOCKS (LOGSIZE/2)  // or once it logs this many blocks
+#define NTRIM        512  // freed blocks a transaction discards once committed
 #define FSSIZE       1000  // size of file system in blocks
 #define MAXPATH      128   // maximum file path name
 #define NDISK        2
@@ -7,42 +7,70 @@
 #include "fs.h"
 #include "file.h"
 #include "proc.h"
+#include "wait.h"
+#include "procinfo.h"
 #include "defs.h"
 
 struct cpu cpus[NCPU];
 
-struct proc proc[NPROC];
+// Every proc structure ever allocated, linked through p->allnext.
+// proc structures are carved out of kalloc() pages on demand and
+// are never given back, only recycled through ptable.free, so
+// scheduler(), wakeup() &c can walk this list without a lock.
+// p->lock protects the contents of each entry, as usual.
+struct proc *allproc;
+
+struct {
+  struct spinlock lock;
+  struct proc *free;   // UNUSED procs, linked through p->freenext
+  int nproc;           // proc structures allocated so far
+  char *slab;          // unused tail of the current proc page
+  char *slabend;
+} ptable;
 
 struct proc *initproc;
 
 int nextpid = 1;
 struct spinlock pid_lock;
 
+// CPUs that have reached scheduler(); see setaffinity().
+uint64 cpus_online;
+
+// CPUs about to wait in scheduler() for a RUNNABLE process;
+// see kickidle().
+uint64 cpus_idle;
+
+// protects every proc's parent, children and sibling fields,
+// and ensures that wakeups of wait()ing parents are not lost.
+// must be acquired before any p->lock.
+struct spinlock wait_lock;
+
+// pid -> proc hash table, so kill() needn't scan every proc.
+// pid_lock protects changes to the chains, and nextpid.
+// findproc() walks them without locks, under rcu_read_lock();
+// so a freed proc keeps its pidnext, and isn't put on another
+// chain until the readers that might be on it are done.
+#define NPIDHASH 64
+#define PIDHASH(pid) ((uint)(pid) % NPIDHASH)
+struct proc *pidhash[NPIDHASH];
+
 extern void forkret(void);
+static void kthreadstart(void);
 static void wakeup1(struct proc *chan);
+static void setrunnable(struct proc *p);
+static void setrunning(struct proc *p, int id);
+static int canrun(struct proc *p, int id, int local);
+static void freeproc(struct proc *p);
 
 extern char trampoline[]; // trampoline.S
+extern pagetable_t kernel_pagetable; // vm.c
 
 void
 procinit(void)
 {
-  struct proc *p;
-  
   initlock(&pid_lock, "nextpid");
-  for(p = proc; p < &proc[NPROC]; p++) {
-      initlock(&p->lock, "proc");
-
-      // Allocate a page for the process's kernel stack.
-      // Map it high in memory, followed by an invalid
-      // guard page.
-      char *pa = kalloc();
-      if(pa == 0)
-        panic("kalloc");
-      uint64 va = KSTACK((int) (p - proc));
-      kvmmap(va, (uint64)pa, PGSIZE, PTE_R | PTE_W);
-      p->kstack = va;
-  }
-  kvminithart();
+  initlock(&wait_lock, "wait_lock");
+  initlock(&ptable.lock, "ptable");
 }
 
 // Must be called with interrupts disabled,
@@ -86,7 +114,114 @@ allocpid() {
   return pid;
 }
 
-// Look in the process table for an UNUSED proc.
+// Add p to the pid hash table.
+// p->lock must be held.
+static void
+pidhash_insert(struct proc *p)
+{
+  struct proc **pp;
+
+  acquire(&pid_lock);
+  pp = &pidhash[PIDHASH(p->pid)];
+  p->pidnext = *pp;
+  __sync_synchronize();  // findproc() must see pidnext and pid first.
+  *pp = p;
+  release(&pid_lock);
+}
+
+// Remove p from the pid hash table, if it's there.
+// p->lock must be held.
+static void
+pidhash_remove(struct proc *p)
+{
+  struct proc **pp;
+
+  acquire(&pid_lock);
+  for(pp = &pidhash[PIDHASH(p->pid)]; *pp; pp = &(*pp)->pidnext){
+    if(*pp == p){
+      *pp = p->pidnext;
+      break;
+    }
+  }
+  release(&pid_lock);
+}
+
+// Find the process with the given pid.
+// Returns with p->lock held, or 0 if there is no such process.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  rcu_read_lock();
+  for(p = *(struct proc * volatile *)&pidhash[PIDHASH(pid)]; p; p = p->pidnext)
+    if(p->pid == pid)
+      break;
+  rcu_read_unlock();
+  if(p == 0)
+    return 0;
+
+  // p may have been freed and reused since the read section
+  // ended. that's harmless, since proc structures are
+  // never returned to kalloc(); lock it and check again.
+  acquire(&p->lock);
+  if(p->pid != pid){
+    release(&p->lock);
+    return 0;
+  }
+  return p;
+}
+
+// Allocate a fresh proc structure and its kernel stack.
+// Called when the free list is empty.
+// Caller must hold ptable.lock.
+// Returns 0 if NPROC is reached or memory is exhausted.
+static struct proc*
+procgrow(void)
+{
+  struct proc *p;
+  char *pa;
+  uint64 va;
+
+  if(ptable.nproc >= NPROC)
+    return 0;
+
+  if(ptable.slab == 0 || ptable.slab + sizeof(struct proc) > ptable.slabend){
+    if((pa = kalloc()) == 0)
+      return 0;
+    ptable.slab = pa;
+    ptable.slabend = pa + PGSIZE;
+  }
+
+  // Allocate a page for the process's kernel stack.
+  // Map it high in memory, followed by an invalid
+  // guard page.
+  if((pa = kalloc()) == 0)
+    return 0;
+  va = KSTACK(ptable.nproc);
+  if(mappages(kernel_pagetable, va, PGSIZE, (uint64)pa, PTE_R | PTE_W) != 0){
+    kfree(pa);
+    return 0;
+  }
+  // other harts may have cached the old invalid PTE.
+  tlbshootdown();
+
+  p = (struct proc*)ptable.slab;
+  ptable.slab += sizeof(struct proc);
+  memset(p, 0, sizeof(*p));
+  initlock(&p->lock, "proc");
+  p->kstack = va;
+  ptable.nproc++;
+
+  // publish only once p is fully initialized.
+  p->allnext = allproc;
+  __sync_synchronize();
+  allproc = p;
+
+  return p;
+}
+
+// Take an UNUSED proc from the free list, or allocate a new one.
 // If found, initialize state required to run in the kernel,
 // and return with p->lock held.
 // If there are no free procs, return 0.
@@ -95,21 +230,33 @@ allocproc(void)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++) {
-    acquire(&p->lock);
-    if(p->state == UNUSED) {
-      goto found;
-    } else {
-      release(&p->lock);
-    }
-  }
-  return 0;
+  acquire(&ptable.lock);
+  if((p = ptable.free) != 0)
+    ptable.free = p->freenext;
+  else
+    p = procgrow();
+  release(&ptable.lock);
+  if(p == 0)
+    return 0;
 
-found:
+  acquire(&p->lock);
+  if(p->state != UNUSED)
+    panic("allocproc");
+  p->freenext = 0;
+  rcu_wait(p->retired);  // findproc() may still be walking p->pidnext.
   p->pid = allocpid();
+  p->affinity = ~0L;
+  p->lastcpu = -1;
+  p->fpused = 0;
+  p->fpcpu = -1;
+  p->rticks = p->wticks = 0;
+  p->nvcsw = p->nivcsw = 0;
+  p->nsyscall = 0;
+  p->kfn = 0;
 
   // Allocate a trapframe page.
   if((p->tf = (struct trapframe *)kalloc()) == 0){
+    freeproc(p);
     release(&p->lock);
     return 0;
   }
@@ -123,11 +270,14 @@ found:
   p->context.ra = (uint64)forkret;
   p->context.sp = p->kstack + PGSIZE;
 
+  pidhash_insert(p);
+
   return p;
 }
 
 // free a proc structure and the data hanging from it,
-// including user pages.
+// including user pages, and put it back on the free list.
+// The kernel stack stays with the proc structure.
 // p->lock must be held.
 static void
 freeproc(struct proc *p)
@@ -139,12 +289,22 @@ freeproc(struct proc *p)
     proc_freepagetable(p->pagetable, p->sz);
   p->pagetable = 0;
   p->sz = 0;
+  pidhash_remove(p);
+  p->retired = rcu_retire();
   p->pid = 0;
   p->parent = 0;
+  p->children = 0;
+  p->sibling = 0;
+  p->xstate = 0;
   p->name[0] = 0;
   p->chan = 0;
   p->killed = 0;
   p->state = UNUSED;
+
+  acquire(&ptable.lock);
+  p->freenext = ptable.free;
+  ptable.free = p;
+  release(&ptable.lock);
 }
 
 // Create a page table for a given process,
@@ -168,6 +328,11 @@ proc_pagetable(struct proc *p)
   mappages(pagetable, TRAPFRAME, PGSIZE,
            (uint64)(p->tf), PTE_R | PTE_W);
 
+  // map the time page below that, read-only, so that
+  // user code can read the clock without a system call.
+  mappages(pagetable, TIMEPAGE, PGSIZE,
+           (uint64)timepage, PTE_R | PTE_U);
+
   return pagetable;
 }
 
@@ -178,6 +343,7 @@ proc_freepagetable(pagetable_t pagetable, uint64 sz)
 {
   uvmunmap(pagetable, TRAMPOLINE, PGSIZE, 0);
   uvmunmap(pagetable, TRAPFRAME, PGSIZE, 0);
+  uvmunmap(pagetable, TIMEPAGE, PGSIZE, 0);
   if(sz > 0)
     uvmfree(pagetable, sz);
 }
@@ -215,11 +381,27 @@ userinit(void)
   safestrcpy(p->name, "initcode", sizeof(p->name));
   p->cwd = namei("/");
 
-  p->state = RUNNABLE;
+  setrunnable(p);
 
   release(&p->lock);
 }
 
+// Start a kernel thread that runs fn(), which must not
+// return. It has no user memory and never enters user space.
+void
+kthread(char *name, void (*fn)(void))
+{
+  struct proc *p;
+
+  if((p = allocproc()) == 0)
+    panic("kthread");
+  p->kfn = fn;
+  p->context.ra = (uint64)kthreadstart;
+  safestrcpy(p->name, name, sizeof(p->name));
+  setrunnable(p);
+  release(&p->lock);
+}
+
 // Grow or shrink user memory by n bytes.
 // Return 0 on success, -1 on failure.
 int
@@ -264,14 +446,19 @@ fork(void)
   }
   np->sz = p->sz;
 
-  np->parent = p;
-
   // copy saved user registers.
   *(np->tf) = *(p->tf);
 
   // Cause fork to return 0 in the child.
   np->tf->a0 = 0;
 
+  // copy FP registers, which may be live only in this CPU's FPU.
+  if(p->fpused){
+    fpflush(p);
+    np->fp = p->fp;
+    np->fpused = 1;
+  }
+
   // increment reference counts on open file descriptors.
   for(i = 0; i < NOFILE; i++)
     if(p->ofile[i])
@@ -280,49 +467,58 @@ fork(void)
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
+  np->affinity = p->affinity;
+
   pid = np->pid;
 
-  np->state = RUNNABLE;
+  release(&np->lock);
+
+  acquire(&wait_lock);
+  np->parent = p;
+  np->sibling = p->children;
+  p->children = np;
+  release(&wait_lock);
 
+  acquire(&np->lock);
+  setrunnable(np);
   release(&np->lock);
 
   return pid;
 }
 
 // Pass p's abandoned children to init.
-// Caller must hold p->lock and parent->lock.
-void
-reparent(struct proc *p, struct proc *parent) {
-  struct proc *pp;
-  int child_of_init = (p->parent == initproc);
-
-  for(pp = proc; pp < &proc[NPROC]; pp++){
-    // this code uses pp->parent without holding pp->lock.
-    // acquiring the lock first could cause a deadlock
-    // if pp or a child of pp were also in exit()
-    // and about to try to lock p.
-    if(pp->parent == p){
-      // pp->parent can't change between the check and the acquire()
-      // because only the parent changes it, and we're the parent.
-      acquire(&pp->lock);
-      pp->parent = initproc;
-      if(pp->state == ZOMBIE) {
-        if(!child_of_init)
-          acquire(&initproc->lock);
-        wakeup1(initproc);
-        if(!child_of_init)
-          release(&initproc->lock);
-      }
-      release(&pp->lock);
-    }
+// Caller must hold wait_lock.
+static void
+reparent(struct proc *p)
+{
+  struct proc *pp, *last;
+  int zombie = 0;
+
+  if(p->children == 0)
+    return;
+
+  for(pp = p->children; pp; pp = pp->sibling){
+    pp->parent = initproc;
+    // reading pp->state without pp->lock is ok: a child that
+    // becomes a ZOMBIE after this check will wake init itself,
+    // since it will see its new parent under wait_lock.
+    if(pp->state == ZOMBIE)
+      zombie = 1;
+    last = pp;
   }
+  last->sibling = initproc->children;
+  initproc->children = p->children;
+  p->children = 0;
+
+  if(zombie)
+    wakeup1(initproc);
 }
 
-// Exit the current process.  Does not return.
+// Exit the current process with the given status.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait().
 void
-exit(void)
+exit(int status)
 {
   struct proc *p = myproc();
 
@@ -343,19 +539,20 @@ exit(void)
   end_op(ROOTDEV);
   p->cwd = 0;
 
-  acquire(&p->parent->lock);
-
-  acquire(&p->lock);
+  acquire(&wait_lock);
 
   // Give any children to init.
-  reparent(p, p->parent);
+  reparent(p);
 
   // Parent might be sleeping in wait().
   wakeup1(p->parent);
 
+  acquire(&p->lock);
+
+  p->xstate = status;
   p->state = ZOMBIE;
 
-  release(&p->parent->lock);
+  release(&wait_lock);
 
   // Jump into the scheduler, never to return.
   sched();
@@ -363,50 +560,62 @@ exit(void)
 }
 
 // Wait for a child process to exit and return its pid.
-// Return -1 if this process has no children.
+// pid -1 waits for any child; otherwise only for that child.
+// If addr != 0, copy the child's exit status to addr.
+// With WNOHANG, return 0 instead of sleeping if no child has exited.
+// Return -1 if this process has no such children.
 int
-wait(void)
+waitpid(int pid, uint64 addr, int options)
 {
-  struct proc *np;
-  int havekids, pid;
+  struct proc *np, **pp;
+  int havekids, xpid;
   struct proc *p = myproc();
 
-  // hold p->lock for the whole time to avoid lost
+  // hold wait_lock for the whole time to avoid lost
   // wakeups from a child's exit().
-  acquire(&p->lock);
+  acquire(&wait_lock);
 
   for(;;){
-    // Scan through table looking for exited children.
+    // Scan through our children looking for exited ones.
     havekids = 0;
-    for(np = proc; np < &proc[NPROC]; np++){
-      // this code uses np->parent without holding np->lock.
-      // acquiring the lock first would cause a deadlock,
-      // since np might be an ancestor, and we already hold p->lock.
-      if(np->parent == p){
-        // np->parent can't change between the check and the acquire()
-        // because only the parent changes it, and we're the parent.
-        acquire(&np->lock);
-        havekids = 1;
-        if(np->state == ZOMBIE){
-          // Found one.
-          pid = np->pid;
-          freeproc(np);
+    for(pp = &p->children; (np = *pp) != 0; pp = &np->sibling){
+      // np->pid can't change while np is our child, since
+      // only we can free np, so it's ok to check it unlocked.
+      if(pid != -1 && np->pid != pid)
+        continue;
+      havekids = 1;
+      acquire(&np->lock);
+      if(np->state == ZOMBIE){
+        // Found one.
+        xpid = np->pid;
+        if(addr != 0 && copyout(p->pagetable, addr, (char *)&np->xstate,
+                                sizeof(np->xstate)) < 0) {
           release(&np->lock);
-          release(&p->lock);
-          return pid;
+          release(&wait_lock);
+          return -1;
         }
+        *pp = np->sibling;
+        freeproc(np);
         release(&np->lock);
+        release(&wait_lock);
+        return xpid;
       }
+      release(&np->lock);
     }
 
     // No point waiting if we don't have any children.
     if(!havekids || p->killed){
-      release(&p->lock);
+      release(&wait_lock);
       return -1;
     }
+
+    if(options & WNOHANG){
+      release(&wait_lock);
+      return 0;
+    }
     
     // Wait for a child to exit.
-    sleep(p, &p->lock);  //DOC: wait-sleep
+    sleep(p, &wait_lock);  //DOC: wait-sleep
   }
 }
 
@@ -420,44 +629,138 @@ wait(void)
 void
 scheduler(void)
 {
-  struct proc *p;
+  struct proc *p, *last;
   struct cpu *c = mycpu();
+  int id = cpuid();
   
   c->proc = 0;
+  __sync_fetch_and_or(&cpus_online, 1L << id);
   for(;;){
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
 
+    // Advertise this CPU as idle before looking, so that a
+    // process made RUNNABLE after the scan has passed it gets
+    // an IPI sent our way, which keeps the wfi from sleeping.
+    __sync_fetch_and_or(&cpus_idle, 1L << id);
+
+    // First look only at processes that last ran on this CPU
+    // (or have never run), so that a process keeps coming back
+    // to the CPU whose caches and TLB still hold its state.
+    // Only if there are none, take any process allowed here.
     int found = 0;
-    for(p = proc; p < &proc[NPROC]; p++) {
-      acquire(&p->lock);
-      if(p->state == RUNNABLE) {
-        // Switch to chosen process.  It is the process's job
-        // to release its lock and then reacquire it
-        // before jumping back to us.
-        p->state = RUNNING;
-        c->proc = p;
-        swtch(&c->scheduler, &p->context);
-
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        c->proc = 0;
-
-        found = 1;
+    for(int local = 1; local >= 0 && found == 0; local--){
+      for(p = allproc; p; p = p->allnext) {
+        acquire(&p->lock);
+        if(p->state == RUNNABLE && canrun(p, id, local)) {
+          // Switch to chosen process.  It is the process's job
+          // to release its lock and then reacquire it
+          // before jumping back to us.
+          __sync_fetch_and_and(&cpus_idle, ~(1L << id));
+          setrunning(p, id);
+          swtch(&c->scheduler, &p->context);
+
+          // Process is done running for now.
+          // It should have changed its p->state before coming back.
+          // It may have switched directly to other processes in
+          // the meantime (see sched()), so the one that came back,
+          // holding its own lock, isn't necessarily p.
+          last = c->proc;
+          c->proc = 0;
+          release(&last->lock);
+
+          found = 1;
+          continue;
+        }
+        release(&p->lock);
       }
-      release(&p->lock);
     }
     if(found == 0){
+      // Sleep until an interrupt, unless kickidle() has claimed
+      // this CPU since we advertised. An IPI sent after the
+      // check still ends the wfi, because it is pending even
+      // with interrupts off.
+      intr_off();
+      if(*(volatile uint64*)&cpus_idle & (1L << id))
+        asm volatile("wfi");
       intr_on();
-      asm volatile("wfi");
     }
   }
 }
 
-// Switch to scheduler.  Must hold only p->lock
-// and have changed proc->state. Saves and restores
-// intena because intena is a property of this
-// kernel thread, not this CPU. It should
+// May p run on CPU id? If local, only if it last ran
+// there, or has never run, or last ran on a CPU it may no
+// longer use (see setaffinity()), which makes it local to
+// every CPU it may use; otherwise local work on those CPUs
+// could starve it.
+static int
+canrun(struct proc *p, int id, int local)
+{
+  if((p->affinity & (1L << id)) == 0)
+    return 0;
+  return !local || p->lastcpu == id || p->lastcpu < 0 ||
+    (p->affinity & (1L << p->lastcpu)) == 0;
+}
+
+// Make p the current process on this CPU, which is CPU id.
+// Caller must hold p->lock.
+static void
+setrunning(struct proc *p, int id)
+{
+  p->state = RUNNING;
+  p->lastcpu = id;
+  p->wticks += ticks - p->readyticks;
+  mycpu()->proc = p;
+}
+
+// Find a RUNNABLE process other than p that may run on
+// CPU id, for sched() to switch to directly. Starts after p,
+// so that processes take turns. Uses tryacquire(), since the
+// caller holds p->lock and another CPU may be doing the same
+// thing the other way round.
+// Returns the process with its lock held, or 0.
+static struct proc*
+pickdirect(struct proc *p, int id)
+{
+  struct proc *np;
+
+  for(int local = 1; local >= 0; local--){
+    for(np = p->allnext ? p->allnext : allproc; np != p;
+        np = np->allnext ? np->allnext : allproc){
+      // unlocked peek; checked again below.
+      if(np->state != RUNNABLE)
+        continue;
+      if(tryacquire(&np->lock) == 0)
+        continue;
+      if(np->state == RUNNABLE && canrun(np, id, local))
+        return np;
+      release(&np->lock);
+    }
+  }
+  return 0;
+}
+
+// Finish a direct switch on this CPU: release the lock of
+// the process that sched() switched away from, if any.
+static void
+finishswitch(void)
+{
+  struct cpu *c = mycpu();
+  struct proc *prev = c->prev;
+
+  if(prev){
+    c->prev = 0;
+    release(&prev->lock);
+  }
+}
+
+// Switch away from the current process.  Must hold only p->lock
+// and have changed proc->state. If another process is ready to
+// run here, switch straight to it, handing over p->lock for it to
+// release in finishswitch(); otherwise switch to scheduler().
+// Either way, we come back holding p->lock.
+// Saves and restores intena because intena is a
+// property of this kernel thread, not this CPU. It should
 // be proc->intena and proc->noff, but that would
 // break in the few places where a lock is held but
 // there's no process.
@@ -465,41 +768,72 @@ void
 sched(void)
 {
   int intena;
-  struct proc *p = myproc();
+  struct proc *p = myproc(), *np;
+  struct cpu *c = mycpu();
 
   if(!holding(&p->lock))
     panic("sched p->lock");
-  if(mycpu()->noff != 1)
+  if(c->noff != 1)
     panic("sched locks");
   if(p->state == RUNNING)
     panic("sched running");
   if(intr_get())
     panic("sched interruptible");
 
-  intena = mycpu()->intena;
-  swtch(&p->context, &mycpu()->scheduler);
+  fpflush(p);
+
+  intena = c->intena;
+  if((np = pickdirect(p, cpuid())) != 0){
+    setrunning(np, cpuid());
+    c->prev = p;
+    swtch(&p->context, &np->context);
+  } else {
+    swtch(&p->context, &c->scheduler);
+  }
+  finishswitch();
   mycpu()->intena = intena;
 }
 
+// Save p's FP registers in p->fp if p has modified them
+// since they were loaded into this CPU. p must be the
+// current process. The CPU's registers stay loaded, so
+// usertrapret() need not restore them if p runs here next.
+void
+fpflush(struct proc *p)
+{
+  uint64 x;
+
+  push_off();
+  x = r_sstatus();
+  if((x & SSTATUS_FS) == SSTATUS_FS_DIRTY){
+    fpsave(&p->fp);
+    w_sstatus((x & ~SSTATUS_FS) | SSTATUS_FS_CLEAN);
+  }
+  pop_off();
+}
+
 // Give up the CPU for one scheduling round.
 void
 yield(void)
 {
   struct proc *p = myproc();
   acquire(&p->lock);
-  p->state = RUNNABLE;
+  setrunnable(p);
+  p->nivcsw++;
   sched();
   release(&p->lock);
 }
 
 // A fork child's very first scheduling by scheduler()
-// will swtch to forkret.
+// or sched() will swtch to forkret.
 void
 forkret(void)
 {
   static int first = 1;
 
-  // Still holding p->lock from scheduler.
+  // Still holding p->lock from scheduler() or sched(), and
+  // maybe the lock of the process sched() switched away from.
+  finishswitch();
   release(&myproc()->lock);
 
   if (first) {
@@ -513,6 +847,26 @@ forkret(void)
   usertrapret();
 }
 
+// A kernel thread's very first scheduling by scheduler()
+// will swtch to kthreadstart.
+static void
+kthreadstart(void)
+{
+  struct proc *p = myproc();
+
+  // Still holding p->lock from scheduler() or sched().
+  finishswitch();
+  release(&p->lock);
+
+  // after a direct switch, release() restored the intena of
+  // the process sched() switched away from, which may have had
+  // interrupts off; this thread starts with them on.
+  intr_on();
+
+  p->kfn();
+  panic("kthread returned");
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
@@ -534,6 +888,7 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  p->nvcsw++;
 
   sched();
 
@@ -554,23 +909,66 @@ wakeup(void *chan)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++) {
+  for(p = allproc; p; p = p->allnext) {
     acquire(&p->lock);
     if(p->state == SLEEPING && p->chan == chan) {
-      p->state = RUNNABLE;
+      setrunnable(p);
     }
     release(&p->lock);
   }
 }
 
-// Wake up p if it is sleeping in wait(); used by exit().
+// If a CPU that may run p is idle in scheduler(), send it
+// an IPI so that it notices p now rather than at its next
+// timer tick. Prefers the CPU p last ran on. Claims the CPU
+// by clearing its idle bit, so that a burst of wakeups spreads
+// over the idle CPUs, and so that scheduler() won't wfi if
+// this is an interrupt on the idle CPU itself.
+static void
+kickidle(struct proc *p)
+{
+  uint64 idle = cpus_idle & p->affinity;
+  int id;
+
+  if(idle == 0)
+    return;
+  if(p->lastcpu >= 0 && (idle & (1L << p->lastcpu)))
+    id = p->lastcpu;
+  else
+    for(id = 0; (idle & (1L << id)) == 0; id++)
+      ;
+  __sync_fetch_and_and(&cpus_idle, ~(1L << id));
+  if(id != cpuid())
+    sendipi(id, IPI_RESCHED);
+}
+
+// Mark p RUNNABLE, noting when for its wait-time accounting.
+// A process that was running (yield()) stays where it is,
+// unless setaffinity() has moved it off this CPU; any other
+// is offered to an idle CPU.
 // Caller must hold p->lock.
 static void
+setrunnable(struct proc *p)
+{
+  int wasrunning = p->state == RUNNING;
+
+  p->state = RUNNABLE;
+  p->readyticks = ticks;
+  // p->lock is held, so interrupts are off and cpuid() is stable.
+  if(!wasrunning || (p->affinity & (1L << cpuid())) == 0)
+    kickidle(p);
+}
+
+// Wake up p if it is sleeping in wait(); used by exit().
+// Caller must hold wait_lock, and not p->lock.
+static void
 wakeup1(struct proc *p)
 {
+  acquire(&p->lock);
   if(p->chan == p && p->state == SLEEPING) {
-    p->state = RUNNABLE;
+    setrunnable(p);
   }
+  release(&p->lock);
 }
 
 // Kill the process with the given pid.
@@ -581,20 +979,114 @@ kill(int pid)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++){
+  if((p = findproc(pid)) == 0)
+    return -1;
+  p->killed = 1;
+  if(p->state == SLEEPING){
+    // Wake process from sleep().
+    setrunnable(p);
+  }
+  release(&p->lock);
+  return 0;
+}
+
+// Restrict the process with the given pid (0 means the caller)
+// to the CPUs in mask. Bits for CPUs that aren't running are
+// ignored; if none are left, fail.
+int
+setaffinity(int pid, uint64 mask)
+{
+  struct proc *p, *me = myproc();
+  int migrate;
+
+  mask &= cpus_online;
+  if(mask == 0)
+    return -1;
+  if((p = findproc(pid == 0 ? me->pid : pid)) == 0)
+    return -1;
+  p->affinity = mask;
+  // p->lock is held, so interrupts are off and cpuid() is stable.
+  migrate = (p == me && (mask & (1L << cpuid())) == 0);
+  release(&p->lock);
+
+  // move off this CPU right away.
+  if(migrate)
+    yield();
+  return 0;
+}
+
+// Return the CPU mask of the process with the given pid
+// (0 means the caller) in *mask.
+int
+getaffinity(int pid, uint64 *mask)
+{
+  struct proc *p;
+
+  if((p = findproc(pid == 0 ? myproc()->pid : pid)) == 0)
+    return -1;
+  *mask = p->affinity & cpus_online;
+  release(&p->lock);
+  return 0;
+}
+
+// Copy p's counters into ru.
+// Caller must hold p->lock, or be p.
+static void
+getru(struct proc *p, struct rusage *ru)
+{
+  ru->rticks = p->rticks;
+  ru->wticks = p->wticks;
+  ru->nvcsw = p->nvcsw;
+  ru->nivcsw = p->nivcsw;
+  ru->nsyscall = p->nsyscall;
+}
+
+// Copy the calling process's counters to user address addr.
+int
+getrusage(uint64 addr)
+{
+  struct proc *p = myproc();
+  struct rusage ru;
+
+  getru(p, &ru);
+  return copyout(p->pagetable, addr, (char *)&ru, sizeof(ru));
+}
+
+// Copy a snapshot of up to max processes to the array of
+// struct procinfo at user address addr.
+// Returns the number of entries filled in, or -1.
+int
+getprocinfo(uint64 addr, int max)
+{
+  struct proc *p, *me = myproc();
+  struct procinfo pi;
+  int n = 0;
+
+  // wait_lock keeps p->parent stable.
+  acquire(&wait_lock);
+  for(p = allproc; p && n < max; p = p->allnext){
     acquire(&p->lock);
-    if(p->pid == pid){
-      p->killed = 1;
-      if(p->state == SLEEPING){
-        // Wake process from sleep().
-        p->state = RUNNABLE;
-      }
+    if(p->state == UNUSED){
       release(&p->lock);
-      return 0;
+      continue;
     }
+    pi.pid = p->pid;
+    pi.ppid = p->parent ? p->parent->pid : 0;
+    pi.state = p->state;
+    pi.lastcpu = p->lastcpu;
+    pi.sz = p->sz;
+    getru(p, &pi.ru);
+    safestrcpy(pi.name, p->name, sizeof(pi.name));
     release(&p->lock);
+
+    if(copyout(me->pagetable, addr + n*sizeof(pi), (char *)&pi, sizeof(pi)) < 0){
+      release(&wait_lock);
+      return -1;
+    }
+    n++;
   }
-  return -1;
+  release(&wait_lock);
+  return n;
 }
 
 // Copy to either a user address, or kernel address,
@@ -644,14 +1136,15 @@ procdump(void)
   char *state;
 
   printf("\n");
-  for(p = proc; p < &proc[NPROC]; p++){
+  for(p = allproc; p; p = p->allnext){
     if(p->state == UNUSED)
       continue;
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
       state = states[p->state];
     else
       state = "???";
-    printf("%d %s %s", p->pid, state, p->name);
+    printf("%d %s %s run %d wait %d csw %d/%d", p->pid, state, p->name,
+           (int)p->rticks, (int)p->wticks, (int)p->nvcsw, (int)p->nivcsw);
     printf("\n");
   }
 }
@@ -22,12 +22,21 @@ struct context {
 struct cpu {
   struct proc *proc;          // The process running on this cpu, or null.
   struct context scheduler;   // swtch() here to enter scheduler().
+  struct proc *prev;          // Process whose lock sched() handed over.
+  struct proc *fpowner;       // Process whose FP registers were last loaded here.
+  int ipi;                    // Reasons for pending IPIs (IPI_*); see sendipi().
+  uint64 rcuepoch;            // Epoch when the current read section began, or 0.
+  int rcunest;                // Depth of rcu_read_lock() nesting.
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
 };
 
 extern struct cpu cpus[NCPU];
 
+// why one CPU interrupted another; see sendipi() in trap.c.
+#define IPI_RESCHED   0x1   // a process became RUNNABLE; leave wfi
+#define IPI_TLBFLUSH  0x2   // the kernel page table changed; sfence.vma
+
 // per-process data for the trap handling code in trampoline.S.
 // sits in a page by itself just under the trampoline page in the
 // user page table. not specially mapped in the kernel page table.
@@ -80,6 +89,14 @@ struct trapframe {
   /* 280 */ uint64 t6;
 };
 
+// saved user floating-point registers; see fp.S.
+// a process's registers are loaded lazily by usertrapret(),
+// and saved by sched() only if the process modified them.
+struct fpstate {
+  /*   0 */ uint64 f[32];
+  /* 256 */ uint64 fcsr;
+};
+
 enum procstate { UNUSED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
@@ -88,10 +105,32 @@ struct proc {
 
   // p->lock must be held when using these:
   enum procstate state;        // Process state
-  struct proc *parent;         // Parent process
   void *chan;                  // If non-zero, sleeping on chan
   int killed;                  // If non-zero, have been killed
+  int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
+  uint64 affinity;             // CPUs this process may run on, one bit each
+  int lastcpu;                 // CPU this process last ran on, or -1
+  uint readyticks;             // ticks when last made RUNNABLE
+
+  // accounting, reported by getrusage() and getprocinfo().
+  // updated only by the process itself or under p->lock.
+  uint64 rticks;               // Timer ticks spent running
+  uint64 wticks;               // Ticks spent RUNNABLE
+  uint64 nvcsw;                // Voluntary context switches
+  uint64 nivcsw;               // Involuntary context switches
+  uint64 nsyscall;             // System calls
+
+  // wait_lock must be held when using these:
+  struct proc *parent;         // Parent process
+  struct proc *children;       // Most recently forked child
+  struct proc *sibling;        // Next child of the same parent
+
+  // proc table bookkeeping; see allocproc() in proc.c.
+  struct proc *allnext;        // Next in allproc list; never changes once set
+  struct proc *freenext;       // Next on free list (ptable.lock)
+  struct proc *pidnext;        // Next in pid hash chain (pid_lock)
+  uint64 retired;              // rcu_retire() epoch when last freed
 
   // these are private to the process, so p->lock need not be held.
   uint64 kstack;               // Bottom of kernel stack for this process
@@ -99,7 +138,11 @@ struct proc {
   pagetable_t pagetable;       // Page table
   struct trapframe *tf;        // data page for trampoline.S
   struct context context;      // swtch() here to run process
+  int fpused;                  // Has executed an FP instruction
+  int fpcpu;                   // CPU holding the latest FP registers, or -1
+  struct fpstate fp;           // Saved FP registers
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
+  void (*kfn)(void);           // Kernel thread's body, or 0
   char name[16];               // Process name (debugging)
 };
@@ -0,0 +1,28 @@
+// Per-process scheduling and resource counters,
+// returned by getrusage() and getprocinfo().
+// Times are in clock ticks.
+struct rusage {
+  uint64 rticks;     // ticks spent running
+  uint64 wticks;     // ticks spent RUNNABLE, waiting for a CPU
+  uint64 nvcsw;      // voluntary context switches (sleeps)
+  uint64 nivcsw;     // involuntary context switches (preemptions)
+  uint64 nsyscall;   // system calls made
+};
+
+// One process's entry in getprocinfo()'s snapshot.
+struct procinfo {
+  int pid;
+  int ppid;          // 0 if no parent
+  int state;         // enum procstate in proc.h
+  int lastcpu;       // CPU it last ran on, or -1
+  uint64 sz;         // size of process memory (bytes)
+  struct rusage ru;
+  char name[16];
+};
+
+// procinfo.state values; must match enum procstate.
+#define PI_UNUSED    0
+#define PI_SLEEPING  1
+#define PI_RUNNABLE  2
+#define PI_RUNNING   3
+#define PI_ZOMBIE    4
@@ -0,0 +1,82 @@
+// Epoch-based reclamation, for lock-free readers of linked
+// structures.
+//
+// A reader brackets its traversal with rcu_read_lock() and
+// rcu_read_unlock(), and must not sleep in between. A writer
+// unlinks an object under its usual lock, then calls
+// rcu_retire(), which advances the global epoch and returns it.
+// The object may be reused or freed once rcu_done() says every
+// CPU has left any read section that began before that epoch,
+// since only those readers can still be looking at it.
+//
+// Readers write only their own CPU's struct cpu.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "spinlock.h"
+#include "riscv.h"
+#include "proc.h"
+#include "defs.h"
+
+uint64 rcu_epoch = 1;
+
+void
+rcu_read_lock(void)
+{
+  struct cpu *c;
+
+  push_off();
+  c = mycpu();
+  if(c->rcunest++ == 0){
+    c->rcuepoch = *(volatile uint64*)&rcu_epoch;
+    // pairs with the fence in rcu_done(): either the writer
+    // sees our epoch, or we see the writer's unlink.
+    __sync_synchronize();
+  }
+}
+
+void
+rcu_read_unlock(void)
+{
+  struct cpu *c = mycpu();
+
+  if(c->rcunest < 1)
+    panic("rcu_read_unlock");
+  if(--c->rcunest == 0){
+    __sync_synchronize();
+    c->rcuepoch = 0;
+  }
+  pop_off();
+}
+
+// Called after unlinking an object. Returns the epoch to
+// pass to rcu_done() or rcu_wait() before reusing it.
+uint64
+rcu_retire(void)
+{
+  return __sync_add_and_fetch(&rcu_epoch, 1);
+}
+
+// Have all readers that might have seen an object
+// retired at epoch e finished?
+int
+rcu_done(uint64 e)
+{
+  __sync_synchronize();
+  for(int i = 0; i < NCPU; i++){
+    uint64 x = *(volatile uint64*)&cpus[i].rcuepoch;
+    if(x != 0 && x < e)
+      return 0;
+  }
+  return 1;
+}
+
+// Spin until rcu_done(e). Read sections are short and
+// can't sleep, so this doesn't wait long.
+void
+rcu_wait(uint64 e)
+{
+  while(!rcu_done(e))
+    ;
+}
@@ -40,6 +40,10 @@ w_mepc(uint64 x)
 
 // Supervisor Status Register, sstatus
 
+#define SSTATUS_FS (3L << 13)  // Floating-point unit status:
+#define SSTATUS_FS_OFF (0L << 13)     //   FP instructions trap
+#define SSTATUS_FS_CLEAN (2L << 13)   //   registers unchanged since restore
+#define SSTATUS_FS_DIRTY (3L << 13)   //   registers modified
 #define SSTATUS_SPP (1L << 8)  // Previous mode, 1=Supervisor, 0=User
 #define SSTATUS_SPIE (1L << 5) // Supervisor Previous Interrupt Enable
 #define SSTATUS_UPIE (1L << 4) // User Previous Interrupt Enable
@@ -234,6 +238,8 @@ r_stval()
 }
 
 // Machine-mode Counter-Enable
+#define MCOUNTEREN_CY (1L << 0) // lower modes may read cycle
+#define MCOUNTEREN_TM (1L << 1) // lower modes may read time
 static inline void 
 w_mcounteren(uint64 x)
 {
@@ -248,6 +254,31 @@ r_mcounteren()
   return x;
 }
 
+// Supervisor Counter-Enable
+#define SCOUNTEREN_TM (1L << 1) // user mode may read time
+static inline void 
+w_scounteren(uint64 x)
+{
+  asm volatile("csrw scounteren, %0" : : "r" (x));
+}
+
+static inline uint64
+r_scounteren()
+{
+  uint64 x;
+  asm volatile("csrr %0, scounteren" : "=r" (x) );
+  return x;
+}
+
+// cycles executed by this hart; not comparable across harts.
+static inline uint64
+r_cycle()
+{
+  uint64 x;
+  asm volatile("csrr %0, cycle" : "=r" (x) );
+  return x;
+}
+
 // machine-mode cycle counter
 static inline uint64
 r_time()
@@ -0,0 +1,83 @@
+// Reader-writer spin locks.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "spinlock.h"
+#include "rwlock.h"
+#include "riscv.h"
+#include "proc.h"
+#include "defs.h"
+
+void
+initrwlock(struct rwlock *rw, char *name)
+{
+  initlock(&rw->lk, name);
+  rw->writer = 0;
+  for(int i = 0; i < NCPU; i++)
+    rw->readers[i].n = 0;
+  rw->name = name;
+}
+
+// Acquire a read hold. Other CPUs may hold it for
+// reading at the same time, but no CPU for writing.
+void
+acquireread(struct rwlock *rw)
+{
+  int *n;
+
+  push_off(); // disable interrupts to avoid deadlock.
+  n = &rw->readers[cpuid()].n;
+
+  // a nested read hold mustn't wait for a writer, which
+  // would be waiting for the outer hold to drain.
+  if((*n)++ > 0)
+    return;
+
+  // announce ourselves, then check for a writer. if one
+  // got in first, back off until it's done. the fence pairs
+  // with the one in acquirewrite(): either the writer sees
+  // our count, or we see its flag.
+  for(;;){
+    __sync_synchronize();
+    if(*(volatile int*)&rw->writer == 0)
+      break;
+    (*n)--;
+    while(*(volatile int*)&rw->writer)
+      ;
+    (*n)++;
+  }
+}
+
+void
+releaseread(struct rwlock *rw)
+{
+  int *n = &rw->readers[cpuid()].n;
+
+  if(*n < 1)
+    panic("releaseread");
+  __sync_synchronize();
+  (*n)--;
+  pop_off();
+}
+
+// Acquire the write hold, excluding all readers and
+// other writers.
+void
+acquirewrite(struct rwlock *rw)
+{
+  acquire(&rw->lk);
+  rw->writer = 1;
+  __sync_synchronize();
+  for(int i = 0; i < NCPU; i++)
+    while(*(volatile int*)&rw->readers[i].n)
+      ;
+}
+
+void
+releasewrite(struct rwlock *rw)
+{
+  __sync_synchronize();
+  rw->writer = 0;
+  release(&rw->lk);
+}
@@ -0,0 +1,17 @@
+// Reader-writer spin locks for read-mostly tables.
+// Each CPU counts its readers in its own cache line, so
+// concurrent readers never write to a shared line; a writer
+// sets writer and waits for every CPU's count to drain.
+// Like spinlocks, holders must not sleep, and a reader
+// can't upgrade to a writer.
+struct rwlock {
+  struct spinlock lk;  // serializes writers
+  int writer;          // a writer holds or is waiting for the lock
+  struct {
+    int n;             // read holds on this CPU
+    char pad[60];      // keep each CPU's count in its own line
+  } readers[NCPU];
+
+  // For debugging:
+  char *name;          // Name of lock.
+};
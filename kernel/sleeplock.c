@@ -8,6 +8,7 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "sleeplock.h"
+#include "lockstat.h"
 
 void
 initsleeplock(struct sleeplock *lk, char *name)
@@ -16,17 +17,61 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->holder = 0;
+  lk->nsleeping = 0;
+#ifdef LOCKSTAT
+  lk->cls = lockclass(name, LS_SLEEP);
+#endif
 }
 
+// How many times acquiresleep() polls a lock whose holder
+// is running before giving up and sleeping.
+#define SPINLIMIT 10000
+
+// Spin while the holder is running on another CPU, since
+// it will probably release the lock before a sleep and
+// wakeup could complete; sleep if it isn't running, or
+// after SPINLIMIT polls.
 void
 acquiresleep(struct sleeplock *lk)
 {
+  struct proc *holder;
+  int spun = 0;
+#ifdef LOCKSTAT
+  uint64 nwait = 0;
+#endif
+
   acquire(&lk->lk);
   while (lk->locked) {
+#ifdef LOCKSTAT
+    nwait++;
+#endif
+    // proc structures are never freed, so holder can be
+    // looked at without locks; its state is only a hint.
+    holder = lk->holder;
+    if(!spun && holder && holder->state == RUNNING){
+      spun = 1;
+      release(&lk->lk);
+      for(int i = 0; i < SPINLIMIT; i++){
+        if(*(volatile uint*)&lk->locked == 0 ||
+           *(volatile enum procstate*)&holder->state != RUNNING)
+          break;
+      }
+      acquire(&lk->lk);
+      continue;
+    }
+    spun = 0;
+    lk->nsleeping++;
     sleep(lk, &lk->lk);
+    lk->nsleeping--;
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  lk->holder = myproc();
+#ifdef LOCKSTAT
+  lockstat_acquired(lk->cls, nwait);
+  lk->tstart = *(uint64*)CLINT_MTIME;  // the holder may change CPUs
+#endif
   release(&lk->lk);
 }
 
@@ -34,9 +79,14 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+#ifdef LOCKSTAT
+  lockstat_released(lk->cls, *(uint64*)CLINT_MTIME - lk->tstart);
+#endif
   lk->locked = 0;
   lk->pid = 0;
-  wakeup(lk);
+  lk->holder = 0;
+  if(lk->nsleeping > 0)
+    wakeup(lk);
   release(&lk->lk);
 }
 
@@ -2,9 +2,15 @@
 struct sleeplock {
   uint locked;       // Is the lock held?
   struct spinlock lk; // spinlock protecting this sleep lock
+  struct proc *holder; // Process holding lock, for acquiresleep() to spin on
+  int nsleeping;     // Processes sleeping in acquiresleep()
   
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+#ifdef LOCKSTAT
+  struct lockclass *cls; // Statistics for locks with this name.
+  uint64 tstart;     // CLINT mtime when acquired.
+#endif
 };
 
@@ -7,15 +7,22 @@
 #include "riscv.h"
 #include "proc.h"
 #include "defs.h"
+#include "lockstat.h"
 
+// number of acquire()s that had to wait, reported by ntas().
+// each of them still costs only one atomic instruction.
 uint64 ntest_and_set;
 
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
-  lk->locked = 0;
+  lk->next = 0;
+  lk->owner = 0;
   lk->cpu = 0;
+#ifdef LOCKSTAT
+  lk->cls = lockclass(name, LS_SPIN);
+#endif
 }
 
 // Acquire the lock.
@@ -23,16 +30,30 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint ticket;
+#ifdef LOCKSTAT
+  uint64 spins = 0;
+#endif
+
   push_off(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // On RISC-V, sync_lock_test_and_set turns into an atomic swap:
-  //   a5 = 1
-  //   s1 = &lk->locked
-  //   amoswap.w.aq a5, a5, (s1)
-  while(__sync_lock_test_and_set(&lk->locked, 1) != 0) {
-     __sync_fetch_and_add(&ntest_and_set, 1);
+  // Take a ticket. On RISC-V, sync_fetch_and_add turns into
+  //   amoadd.w a5, a5, (s1)
+  // which is the only write to the lock's cache line
+  // until release().
+  ticket = __sync_fetch_and_add(&lk->next, 1);
+
+  // Wait for our turn with plain loads, which leave the
+  // line shared among the waiters until release() writes it.
+  if(*(volatile uint*)&lk->owner != ticket){
+    __sync_fetch_and_add(&ntest_and_set, 1);
+    do {
+#ifdef LOCKSTAT
+      spins++;
+#endif
+    } while(*(volatile uint*)&lk->owner != ticket);
   }
   
   // Tell the C compiler and the processor to not move loads or stores
@@ -42,6 +63,37 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for holding() and debugging.
   lk->cpu = mycpu();
+#ifdef LOCKSTAT
+  lockstat_acquired(lk->cls, spins);
+  lk->tstart = r_cycle();
+#endif
+}
+
+// Try to acquire the lock without spinning.
+// Returns 1 if it was acquired, 0 if it was already held.
+int
+tryacquire(struct spinlock *lk)
+{
+  push_off(); // disable interrupts to avoid deadlock.
+  if(holding(lk))
+    panic("tryacquire");
+
+  // Test before test-and-set: only take a ticket if the
+  // lock looks free, and only if nobody takes one first.
+  uint t = *(volatile uint*)&lk->owner;
+  if(*(volatile uint*)&lk->next != t ||
+     !__sync_bool_compare_and_swap(&lk->next, t, t + 1)){
+    pop_off();
+    return 0;
+  }
+  __sync_synchronize();
+
+  lk->cpu = mycpu();
+#ifdef LOCKSTAT
+  lockstat_acquired(lk->cls, 0);
+  lk->tstart = r_cycle();
+#endif
+  return 1;
 }
 
 // Release the lock.
@@ -51,6 +103,9 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+#ifdef LOCKSTAT
+  lockstat_released(lk->cls, r_cycle() - lk->tstart);
+#endif
   lk->cpu = 0;
 
   // Tell the C compiler and the CPU to not move loads or stores
@@ -59,14 +114,12 @@ release(struct spinlock *lk)
   // On RISC-V, this turns into a fence instruction.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
+  // Release the lock by handing it to the next ticket,
+  // equivalent to lk->owner++.
   // This code doesn't use a C assignment, since the C standard
   // implies that an assignment might be implemented with
   // multiple store instructions.
-  // On RISC-V, sync_lock_release turns into an atomic swap:
-  //   s1 = &lk->locked
-  //   amoswap.w zero, zero, (s1)
-  __sync_lock_release(&lk->locked);
+  __sync_fetch_and_add(&lk->owner, 1);
 
   pop_off();
 }
@@ -77,7 +130,7 @@ holding(struct spinlock *lk)
 {
   int r;
   push_off();
-  r = (lk->locked && lk->cpu == mycpu());
+  r = (lk->owner != lk->next && lk->cpu == mycpu());
   pop_off();
   return r;
 }
@@ -1,9 +1,16 @@
 // Mutual exclusion lock.
+// A ticket lock: acquire() takes the next ticket and waits
+// until owner reaches it, so CPUs get the lock in FIFO order
+// and waiters spin reading owner rather than with atomic swaps.
 struct spinlock {
-  uint locked;       // Is the lock held?
+  uint next;         // Next ticket to hand out.
+  uint owner;        // Ticket now allowed to hold the lock.
 
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+#ifdef LOCKSTAT
+  struct lockclass *cls; // Statistics for locks with this name.
+  uint64 tstart;     // r_cycle() when acquired.
+#endif
 };
-
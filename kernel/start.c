@@ -37,6 +37,10 @@ start()
   w_medeleg(0xffff);
   w_mideleg(0xffff);
 
+  // let supervisor mode read the cycle counter, for lockstat,
+  // and the time counter, which it passes on to user mode.
+  w_mcounteren(r_mcounteren() | MCOUNTEREN_CY | MCOUNTEREN_TM);
+
   // ask for clock interrupts.
   timerinit();
 
@@ -51,7 +55,7 @@ start()
 // set up to receive timer interrupts in machine mode,
 // which arrive at timervec in kernelvec.S,
 // which turns them into software interrupts for
-// devintr() in trap.c.
+// devintr() in trap.c. IPIs take the same path.
 void
 timerinit()
 {
@@ -66,9 +70,13 @@ timerinit()
   // scratch[0..3] : space for timervec to save registers.
   // scratch[4] : address of CLINT MTIMECMP register.
   // scratch[5] : desired interval (in cycles) between timer interrupts.
+  // scratch[6] : set by timervec on a timer interrupt; see timerfired().
+  // scratch[7] : address of CLINT MSIP register, for IPIs.
   uint64 *scratch = &mscratch0[32 * id];
   scratch[4] = CLINT_MTIMECMP(id);
   scratch[5] = interval;
+  scratch[6] = 0;
+  scratch[7] = CLINT_MSIP(id);
   w_mscratch((uint64)scratch);
 
   // set the machine-mode trap handler.
@@ -77,6 +85,17 @@ timerinit()
   // enable machine-mode interrupts.
   w_mstatus(r_mstatus() | MSTATUS_MIE);
 
-  // enable machine-mode timer interrupts.
-  w_mie(r_mie() | MIE_MTIE);
+  // enable machine-mode timer and software interrupts;
+  // the latter are IPIs from other CPUs' sendipi().
+  w_mie(r_mie() | MIE_MTIE | MIE_MSIE);
+}
+
+// called by devintr() in supervisor mode: has timervec seen
+// a timer interrupt on this CPU since the last call? the
+// supervisor software interrupt it raises may instead be
+// an IPI.
+int
+timerfired(void)
+{
+  return __sync_lock_test_and_set(&mscratch0[32 * cpuid() + 6], 0) != 0;
 }
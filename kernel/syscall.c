@@ -107,6 +107,17 @@ extern uint64 sys_write(void);
 extern uint64 sys_uptime(void);
 extern uint64 sys_ntas(void);
 extern uint64 sys_crash(void);
+extern uint64 sys_waitpid(void);
+extern uint64 sys_sched_setaffinity(void);
+extern uint64 sys_sched_getaffinity(void);
+extern uint64 sys_getprocinfo(void);
+extern uint64 sys_getrusage(void);
+extern uint64 sys_clock_gettime(void);
+extern uint64 sys_lockstat(void);
+extern uint64 sys_fsync(void);
+extern uint64 sys_sync(void);
+extern uint64 sys_bcachestat(void);
+extern uint64 sys_fstrim(void);
 
 static uint64 (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -132,6 +143,17 @@ static uint64 (*syscalls[])(void) = {
 [SYS_close]   sys_close,
 [SYS_ntas]    sys_ntas,
 [SYS_crash]   sys_crash,
+[SYS_waitpid] sys_waitpid,
+[SYS_sched_setaffinity] sys_sched_setaffinity,
+[SYS_sched_getaffinity] sys_sched_getaffinity,
+[SYS_getprocinfo] sys_getprocinfo,
+[SYS_getrusage] sys_getrusage,
+[SYS_clock_gettime] sys_clock_gettime,
+[SYS_lockstat] sys_lockstat,
+[SYS_fsync]   sys_fsync,
+[SYS_sync]    sys_sync,
+[SYS_bcachestat] sys_bcachestat,
+[SYS_fstrim]  sys_fstrim,
 };
 
 void
@@ -141,6 +163,7 @@ syscall(void)
   struct proc *p = myproc();
 
   num = p->tf->a7;
+  p->nsyscall++;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
     p->tf->a0 = syscalls[num]();
   } else {
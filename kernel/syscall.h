@@ -26,3 +26,14 @@
 #define SYS_crash  23
 #define SYS_mount  24
 #define SYS_umount 25
+#define SYS_waitpid 26
+#define SYS_sched_setaffinity 27
+#define SYS_sched_getaffinity 28
+#define SYS_getprocinfo 29
+#define SYS_getrusage 30
+#define SYS_clock_gettime 31
+#define SYS_lockstat 32
+#define SYS_fsync  33
+#define SYS_sync   34
+#define SYS_bcachestat 35
+#define SYS_fstrim 36
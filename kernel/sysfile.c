@@ -115,6 +115,61 @@ sys_fstat(void)
   return filestat(f, st);
 }
 
+// Make f's file system updates durable.
+uint64
+sys_fsync(void)
+{
+  struct file *f;
+
+  if(argfd(0, 0, &f) < 0)
+    return -1;
+  if(f->type != FD_INODE && f->type != FD_DEVICE)
+    return -1;
+  log_sync(f->ip->dev);
+  return 0;
+}
+
+// Make every file system update durable.
+uint64
+sys_sync(void)
+{
+  for(int dev = 0; dev < NDISK; dev++)
+    log_sync(dev);
+  return 0;
+}
+
+// Discard the free blocks of the file system holding path.
+// Returns how many it discarded, or -2 if its disk can't
+// discard.
+uint64
+sys_fstrim(void)
+{
+  char path[MAXPATH];
+  struct inode *ip;
+  int dev;
+
+  begin_op(ROOTDEV);
+  if(argstr(0, path, MAXPATH) < 0 || (ip = namei(path)) == 0){
+    end_op(ROOTDEV);
+    return -1;
+  }
+  dev = ip->dev;
+  iput(ip);
+  end_op(ROOTDEV);
+  return fstrim(dev);
+}
+
+// copy out buffer cache statistics.
+uint64
+sys_bcachestat(void)
+{
+  uint64 p;
+
+  if(argaddr(0, &p) < 0)
+    return -1;
+  return bcachestat(p);
+}
+
 // Create the path new as a link to the same inode as old.
 uint64
 sys_link(void)
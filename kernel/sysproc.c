@@ -6,11 +6,15 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "time.h"
 
 uint64
 sys_exit(void)
 {
-  exit();
+  int n;
+  if(argint(0, &n) < 0)
+    return -1;
+  exit(n);
   return 0;  // not reached
 }
 
@@ -29,7 +33,18 @@ sys_fork(void)
 uint64
 sys_wait(void)
 {
-  return wait();
+  return waitpid(-1, 0, 0);
+}
+
+uint64
+sys_waitpid(void)
+{
+  int pid, options;
+  uint64 p;
+
+  if(argint(0, &pid) < 0 || argaddr(1, &p) < 0 || argint(2, &options) < 0)
+    return -1;
+  return waitpid(pid, p, options);
 }
 
 uint64
@@ -77,6 +92,65 @@ sys_kill(void)
   return kill(pid);
 }
 
+uint64
+sys_sched_setaffinity(void)
+{
+  int pid;
+  uint64 mask;
+
+  if(argint(0, &pid) < 0 || argaddr(1, &mask) < 0)
+    return -1;
+  return setaffinity(pid, mask);
+}
+
+uint64
+sys_sched_getaffinity(void)
+{
+  int pid;
+  uint64 mask, addr;
+
+  if(argint(0, &pid) < 0 || argaddr(1, &addr) < 0)
+    return -1;
+  if(getaffinity(pid, &mask) < 0)
+    return -1;
+  if(copyout(myproc()->pagetable, addr, (char *)&mask, sizeof(mask)) < 0)
+    return -1;
+  return 0;
+}
+
+uint64
+sys_getprocinfo(void)
+{
+  uint64 p;
+  int n;
+
+  if(argaddr(0, &p) < 0 || argint(1, &n) < 0)
+    return -1;
+  return getprocinfo(p, n);
+}
+
+uint64
+sys_getrusage(void)
+{
+  uint64 p;
+
+  if(argaddr(0, &p) < 0)
+    return -1;
+  return getrusage(p);
+}
+
+// copy out statistics for the n most contended locks.
+uint64
+sys_lockstat(void)
+{
+  uint64 p;
+  int n;
+
+  if(argaddr(0, &p) < 0 || argint(1, &n) < 0)
+    return -1;
+  return lockstat(p, n);
+}
+
 // return how many clock tick interrupts have occurred
 // since start.
 uint64
@@ -89,3 +163,27 @@ sys_uptime(void)
   release(&tickslock);
   return xticks;
 }
+
+// read one of the clocks in time.h. clock_gettime() in
+// ulib.c reads them without a trap; this is its fallback.
+uint64
+sys_clock_gettime(void)
+{
+  int clk;
+  uint64 addr, mtime;
+  struct timespec ts;
+
+  if(argint(0, &clk) < 0 || argaddr(1, &addr) < 0)
+    return -1;
+  if(clk == CLOCK_MONOTONIC)
+    mtime = *(uint64*)CLINT_MTIME;
+  else if(clk == CLOCK_MONOTONIC_COARSE)
+    mtime = timepage->mtime;
+  else
+    return -1;
+  ts.tv_sec = mtime / MTIME_FREQ;
+  ts.tv_nsec = (mtime % MTIME_FREQ) * (1000000000 / MTIME_FREQ);
+  if(copyout(myproc()->pagetable, addr, (char*)&ts, sizeof(ts)) < 0)
+    return -1;
+  return 0;
+}
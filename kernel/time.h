@@ -0,0 +1,22 @@
+// Clocks for clock_gettime(), and the read-only time page
+// that the kernel maps at TIMEPAGE in every process.
+
+#define CLOCK_MONOTONIC         0  // CLINT mtime since boot; reads the time CSR
+#define CLOCK_MONOTONIC_COARSE  1  // as of the last clock tick
+
+#define MTIME_FREQ  10000000  // CLINT mtime increments per second in qemu
+
+struct timespec {
+  uint64 tv_sec;
+  uint64 tv_nsec;
+};
+
+// Updated by clockintr() on every tick. Readers retry
+// while seq is odd or changes under them; see gettimepage()
+// in user/ulib.c.
+struct timepage {
+  uint seq;          // incremented before and after each update
+  uint ticks;        // same as uptime()
+  uint64 mtime;      // CLINT mtime at the last tick
+  uint64 freq;       // mtime increments per second; set once
+};
@@ -5,9 +5,11 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "defs.h"
+#include "time.h"
 
 struct spinlock tickslock;
 uint ticks;
+struct timepage *timepage;  // mapped at TIMEPAGE in every process
 
 extern char trampoline[], uservec[], userret[];
 
@@ -16,10 +18,16 @@ void kernelvec();
 
 extern int devintr();
 
+extern uint64 cpus_online;
+
 void
 trapinit(void)
 {
   initlock(&tickslock, "time");
+  if((timepage = (struct timepage*)kalloc()) == 0)
+    panic("trapinit");
+  memset(timepage, 0, PGSIZE);
+  timepage->freq = MTIME_FREQ;
 }
 
 // set up to take exceptions and traps while in the kernel.
@@ -27,6 +35,10 @@ void
 trapinithart(void)
 {
   w_stvec((uint64)kernelvec);
+
+  // let user mode read the time counter, so that
+  // clock_gettime() in ulib.c needn't trap.
+  w_scounteren(r_scounteren() | SCOUNTEREN_TM);
 }
 
 //
@@ -54,7 +66,7 @@ usertrap(void)
     // system call
 
     if(p->killed)
-      exit();
+      exit(-1);
 
     // sepc points to the ecall instruction,
     // but we want to return to the next instruction.
@@ -67,6 +79,14 @@ usertrap(void)
     syscall();
   } else if((which_dev = devintr()) != 0){
     // ok
+  } else if(r_scause() == 2 && p->fpused == 0){
+    // illegal instruction with the FP unit off: probably
+    // the process's first FP instruction. give it zeroed
+    // FP registers and retry; usertrapret() loads them.
+    // a genuinely illegal instruction will trap again.
+    memset(&p->fp, 0, sizeof(p->fp));
+    p->fpused = 1;
+    p->fpcpu = -1;
   } else {
     printf("usertrap(): unexpected scause %p pid=%d\n", r_scause(), p->pid);
     printf("            sepc=%p stval=%p\n", r_sepc(), r_stval());
@@ -74,7 +94,7 @@ usertrap(void)
   }
 
   if(p->killed)
-    exit();
+    exit(-1);
 
   // give up the CPU if this is a timer interrupt.
   if(which_dev == 2)
@@ -112,6 +132,22 @@ usertrapret(void)
   unsigned long x = r_sstatus();
   x &= ~SSTATUS_SPP; // clear SPP to 0 for user mode
   x |= SSTATUS_SPIE; // enable interrupts in user mode
+
+  // FP unit off until the process first uses it. after that,
+  // reload p's FP registers only if this CPU's FPU doesn't
+  // already hold them, and leave FS Dirty if p has modified
+  // them since the last fpflush().
+  if(p->fpused == 0){
+    x = (x & ~SSTATUS_FS) | SSTATUS_FS_OFF;
+  } else if(mycpu()->fpowner != p || p->fpcpu != cpuid()){
+    w_sstatus((x & ~SSTATUS_FS) | SSTATUS_FS_CLEAN);
+    fprestore(&p->fp);
+    mycpu()->fpowner = p;
+    p->fpcpu = cpuid();
+    x = (x & ~SSTATUS_FS) | SSTATUS_FS_CLEAN;
+  } else if((x & SSTATUS_FS) != SSTATUS_FS_DIRTY){
+    x = (x & ~SSTATUS_FS) | SSTATUS_FS_CLEAN;
+  }
   w_sstatus(x);
 
   // set S Exception Program Counter to the saved user pc.
@@ -155,8 +191,10 @@ kerneltrap()
 
   // the yield() may have caused some traps to occur,
   // so restore trap registers for use by kernelvec.S's sepc instruction.
+  // keep the current FS field, though, since a switch in yield()
+  // may have saved the FP registers and marked them Clean.
   w_sepc(sepc);
-  w_sstatus(sstatus);
+  w_sstatus((sstatus & ~SSTATUS_FS) | (r_sstatus() & SSTATUS_FS));
 }
 
 void
@@ -164,10 +202,58 @@ clockintr()
 {
   acquire(&tickslock);
   ticks++;
+  timepage->seq++;
+  __sync_synchronize();
+  timepage->ticks = ticks;
+  timepage->mtime = *(uint64*)CLINT_MTIME;
+  __sync_synchronize();
+  timepage->seq++;
   wakeup(&ticks);
   release(&tickslock);
 }
 
+// interrupt another CPU, for the reasons in why (IPI_*).
+// the target's timervec clears the CLINT's MSIP bit and
+// raises a supervisor software interrupt, which devintr()
+// hands to ipiintr().
+void
+sendipi(int cpu, int why)
+{
+  __sync_fetch_and_or(&cpus[cpu].ipi, why);
+  __sync_synchronize();
+  *(uint32*)CLINT_MSIP(cpu) = 1;
+}
+
+// flush this CPU's TLB after a kernel page table change,
+// and ask the other CPUs to flush theirs. doesn't wait for
+// them, so it's only for mappings that they can't be
+// using yet, such as a new process's kernel stack.
+void
+tlbshootdown(void)
+{
+  int id;
+
+  sfence_vma();
+  push_off();
+  id = cpuid();
+  for(int i = 0; i < NCPU; i++)
+    if(i != id && (cpus_online & (1L << i)))
+      sendipi(i, IPI_TLBFLUSH);
+  pop_off();
+}
+
+// handle IPIs sent to this CPU. IPI_RESCHED needs no work
+// here: taking the interrupt is enough to get an idle CPU
+// out of wfi in scheduler().
+void
+ipiintr(void)
+{
+  int why = __sync_lock_test_and_set(&mycpu()->ipi, 0);
+
+  if(why & IPI_TLBFLUSH)
+    sfence_vma();
+}
+
 // check if it's an external interrupt or software interrupt,
 // and handle it.
 // returns 2 if timer interrupt,
@@ -194,16 +280,26 @@ devintr()
     plic_complete(irq);
     return 1;
   } else if(scause == 0x8000000000000001L){
-    // software interrupt from a machine-mode timer interrupt,
-    // forwarded by timervec in kernelvec.S.
+    // software interrupt from a machine-mode timer interrupt
+    // or IPI, forwarded by timervec in kernelvec.S.
+
+    // acknowledge the software interrupt by clearing
+    // the SSIP bit in sip. do it first, so that a tick or
+    // IPI arriving while we look raises it again.
+    w_sip(r_sip() & ~2);
+
+    ipiintr();
+    if(!timerfired())
+      return 1;
 
     if(cpuid() == 0){
       clockintr();
     }
-    
-    // acknowledge the software interrupt by clearing
-    // the SSIP bit in sip.
-    w_sip(r_sip() & ~2);
+
+    // charge the tick to whichever process this CPU is running.
+    struct proc *p = myproc();
+    if(p != 0)
+      p->rticks++;
 
     return 2;
   } else {
@@ -27,6 +27,13 @@
 #define VIRTIO_MMIO_INTERRUPT_STATUS	0x060 // read-only
 #define VIRTIO_MMIO_INTERRUPT_ACK	0x064 // write-only
 #define VIRTIO_MMIO_STATUS		0x070 // read/write
+#define VIRTIO_MMIO_CONFIG		0x100 // device-specific config space
+
+// offsets in virtio-blk's config space.
+#define VIRTIO_BLK_CONFIG_NUM_QUEUES 34       // uint16
+#define VIRTIO_BLK_CONFIG_MAX_DISCARD 36      // uint32, sectors
+#define VIRTIO_BLK_CONFIG_MAX_WRITE_ZEROES 48 // uint32, sectors
+#define VIRTIO_BLK_CONFIG_WZ_MAY_UNMAP 56     // uint8
 
 // status register bits, from qemu virtio_config.h
 #define VIRTIO_CONFIG_S_ACKNOWLEDGE	1
@@ -36,16 +43,20 @@
 
 // device feature bits
 #define VIRTIO_BLK_F_RO              5	/* Disk is read-only */
+#define VIRTIO_BLK_F_FLUSH           9	/* Flush command supported */
 #define VIRTIO_BLK_F_SCSI            7	/* Supports scsi command passthru */
 #define VIRTIO_BLK_F_CONFIG_WCE     11	/* Writeback mode available in config */
 #define VIRTIO_BLK_F_MQ             12	/* support more than one vq */
+#define VIRTIO_BLK_F_DISCARD        13	/* Discard command supported */
+#define VIRTIO_BLK_F_WRITE_ZEROES   14	/* Write zeroes command supported */
 #define VIRTIO_F_ANY_LAYOUT         27
 #define VIRTIO_RING_F_INDIRECT_DESC 28
 #define VIRTIO_RING_F_EVENT_IDX     29
 
-// this many virtio descriptors.
-// must be a power of two.
-#define NUM 8
+// at most this many virtio descriptors; fewer if the device's
+// queue is smaller. must be a power of two, and at most 128,
+// for the queue to fit in two pages.
+#define NUM 128
 
 struct VRingDesc {
   uint64 addr;
@@ -55,6 +66,18 @@ struct VRingDesc {
 };
 #define VRING_DESC_F_NEXT  1 // chained with another descriptor
 #define VRING_DESC_F_WRITE 2 // device writes (vs read)
+#define VRING_DESC_F_INDIRECT 4 // addr is a table of descriptors
+
+// most data buffers in one block request.
+#define MAXSEG 32
+
+// most queues per disk; with fewer harts than this, some
+// go unused, and with more, harts share queues.
+#define NVQ 4
+
+// how long virtio_disk_wait() polls before sleeping, in
+// CLINT mtime units (100ns in qemu).
+#define POLLTIME 500
 
 struct VRingUsedElem {
   uint32 id;   // index of start of completed descriptor chain
@@ -64,6 +87,26 @@ struct VRingUsedElem {
 // for disk ops
 #define VIRTIO_BLK_T_IN  0 // read the disk
 #define VIRTIO_BLK_T_OUT 1 // write the disk
+#define VIRTIO_BLK_T_FLUSH 4 // make finished writes durable
+#define VIRTIO_BLK_T_DISCARD 11      // forget sectors
+#define VIRTIO_BLK_T_WRITE_ZEROES 13 // zero sectors, maybe unmapping them
+
+// the first descriptor of a block operation points to one
+// of these. qemu's virtio-blk.c reads it.
+struct virtio_blk_outhdr {
+  uint32 type;
+  uint32 reserved;
+  uint64 sector;
+};
+
+// the data of a discard or write-zeroes request: a range
+// of sectors.
+struct virtio_blk_discard_write_zeroes {
+  uint64 sector;
+  uint32 num_sectors;
+  uint32 flags;
+};
+#define VIRTIO_BLK_WRITE_ZEROES_F_UNMAP 1 // may unmap the range
 
 struct UsedArea {
   uint16 flags;
@@ -20,8 +20,11 @@
 // the address of virtio mmio register r.
 #define R(n, r) ((volatile uint32 *)(VIRTION(n) + (r)))
 
-struct disk {
-  // memory for virtio descriptors &c for queue 0.
+// one virtqueue. a disk has one per hart group, if the device
+// supports VIRTIO_BLK_F_MQ, so that harts submitting I/O at
+// once don't contend for one lock.
+struct virtq {
+  // memory for virtio descriptors &c for the queue.
   // this is a global instead of allocated because it has
   // to be multiple contiguous pages, which kalloc()
   // doesn't support.
@@ -31,25 +34,91 @@ struct disk {
   uint16 *avail;
   struct UsedArea *used;
 
+  int num;         // descriptors in the queue, at most NUM.
+
   // our own book-keeping.
   char free[NUM];  // is a descriptor free?
-  uint16 used_idx; // we've looked this far in used[2..NUM].
+  int freehead;    // free descriptors, linked through desc[].next
+  int nfree;       // how many are free.
+  uint16 used_idx; // we've looked this far in used->elems[].
 
   // track info about in-flight operations,
   // for use when completion interrupt arrives.
   // indexed by first descriptor index of chain.
   struct {
-    struct buf *b;
+    struct buf *b; // first of nb bufs, linked by qnext
+    int nb;
     char status;
+    char write;
+    struct virtio_blk_outhdr hdr;
+    struct virtio_blk_discard_write_zeroes range; // for discards
+    char done;     // request() finished; its waiter frees the chain.
+    // indirect descriptor table, if the request at this
+    // head uses one: header, MAXSEG data, status.
+    struct VRingDesc ind[MAXSEG+2] __attribute__ ((aligned (16)));
   } info[NUM];
 
+  volatile uint16 *used_event;  // in avail; interrupt once used->id passes it
+  volatile uint16 *avail_event; // in used; notify once avail[1] passes it
+  int ninflight;   // requests issued and not yet completed.
+  int nsleeping;   // processes sleeping until a request is done.
+  int descwait;    // request() waits for descriptors.
+
+  struct spinlock lock;
+} __attribute__ ((aligned (PGSIZE)));
+
+struct disk {
+  struct virtq vq[NVQ];
+  int nvq;         // queues in use.
+
+  int indirect;    // negotiated VIRTIO_RING_F_INDIRECT_DESC?
+  int eventidx;    // negotiated VIRTIO_RING_F_EVENT_IDX?
+  int flush;       // negotiated VIRTIO_BLK_F_FLUSH? then it has a write cache.
+  int discard;     // VIRTIO_BLK_T_DISCARD or _WRITE_ZEROES, or 0.
+  uint maxdiscard; // most sectors in one discard.
+
   // initialized?
   int init;
+} disk[NDISK];
 
-  struct spinlock vdisk_lock;
-} __attribute__ ((aligned (PGSIZE))) disk[NDISK];
-  
+// set up queue q of disk n, with as many descriptors as the
+// device allows, up to NUM, and a power of two.
+static void
+initvq(int n, int q)
+{
+  struct virtq *vq = &disk[n].vq[q];
 
+  initlock(&vq->lock, "virtio_disk");
+
+  *R(n, VIRTIO_MMIO_QUEUE_SEL) = q;
+  uint32 max = *R(n, VIRTIO_MMIO_QUEUE_NUM_MAX);
+  if(max == 0)
+    panic("virtio disk has no queue");
+  for(vq->num = NUM; vq->num > max; vq->num /= 2)
+    ;
+  *R(n, VIRTIO_MMIO_QUEUE_NUM) = vq->num;
+  memset(vq->pages, 0, sizeof(vq->pages));
+  *R(n, VIRTIO_MMIO_QUEUE_PFN) = ((uint64)vq->pages) >> PGSHIFT;
+
+  // desc = pages -- num * VRingDesc
+  // avail = pages + num * 16 -- 2 * uint16, then num * uint16,
+  //   then used_event
+  // used = pages + 4096 -- 2 * uint16, then num * vRingUsedElem,
+  //   then avail_event
+
+  vq->desc = (struct VRingDesc *) vq->pages;
+  vq->avail = (uint16*)(((char*)vq->desc) + vq->num*sizeof(struct VRingDesc));
+  vq->used = (struct UsedArea *) (vq->pages + PGSIZE);
+  vq->used_event = &vq->avail[2 + vq->num];
+  vq->avail_event = (uint16*) &vq->used->elems[vq->num];
+
+  for(int i = 0; i < vq->num; i++){
+    vq->free[i] = 1;
+    vq->desc[i].next = i + 1;
+  }
+  vq->freehead = 0;
+  vq->nfree = vq->num;
+}
 
 void
 virtio_disk_init(int n)
@@ -61,8 +130,6 @@ virtio_disk_init(int n)
     return;
 
   printf("virtio disk init %d\n", n);
-  
-  initlock(&disk[n].vdisk_lock, "virtio_disk");
 
   if(*R(n, VIRTIO_MMIO_MAGIC_VALUE) != 0x74726976 ||
      *R(n, VIRTIO_MMIO_VERSION) != 1 ||
@@ -82,11 +149,37 @@ virtio_disk_init(int n)
   features &= ~(1 << VIRTIO_BLK_F_RO);
   features &= ~(1 << VIRTIO_BLK_F_SCSI);
   features &= ~(1 << VIRTIO_BLK_F_CONFIG_WCE);
-  features &= ~(1 << VIRTIO_BLK_F_MQ);
   features &= ~(1 << VIRTIO_F_ANY_LAYOUT);
-  features &= ~(1 << VIRTIO_RING_F_EVENT_IDX);
-  features &= ~(1 << VIRTIO_RING_F_INDIRECT_DESC);
   *R(n, VIRTIO_MMIO_DRIVER_FEATURES) = features;
+  disk[n].indirect = (features & (1 << VIRTIO_RING_F_INDIRECT_DESC)) != 0;
+  disk[n].eventidx = (features & (1 << VIRTIO_RING_F_EVENT_IDX)) != 0;
+  disk[n].flush = (features & (1 << VIRTIO_BLK_F_FLUSH)) != 0;
+  disk[n].nvq = 1;
+  if(features & (1 << VIRTIO_BLK_F_MQ)){
+    disk[n].nvq = *(volatile uint16 *)(VIRTION(n) + VIRTIO_MMIO_CONFIG +
+                                       VIRTIO_BLK_CONFIG_NUM_QUEUES);
+    if(disk[n].nvq > NVQ)
+      disk[n].nvq = NVQ;
+    if(disk[n].nvq < 1)
+      disk[n].nvq = 1;
+  }
+  // discard freed blocks; failing that, zero them, if the
+  // device may unmap zeroed sectors.
+  disk[n].discard = 0;
+  if(features & (1 << VIRTIO_BLK_F_DISCARD)){
+    disk[n].discard = VIRTIO_BLK_T_DISCARD;
+    disk[n].maxdiscard = *R(n, VIRTIO_MMIO_CONFIG +
+                            VIRTIO_BLK_CONFIG_MAX_DISCARD);
+  } else if((features & (1 << VIRTIO_BLK_F_WRITE_ZEROES)) &&
+            *(volatile uchar *)(VIRTION(n) + VIRTIO_MMIO_CONFIG +
+                                VIRTIO_BLK_CONFIG_WZ_MAY_UNMAP)){
+    disk[n].discard = VIRTIO_BLK_T_WRITE_ZEROES;
+    disk[n].maxdiscard = *R(n, VIRTIO_MMIO_CONFIG +
+                            VIRTIO_BLK_CONFIG_MAX_WRITE_ZEROES);
+  }
+  disk[n].maxdiscard -= disk[n].maxdiscard % (BSIZE / 512);
+  if(disk[n].maxdiscard == 0)
+    disk[n].maxdiscard = BSIZE / 512;
 
   // tell device that feature negotiation is complete.
   status |= VIRTIO_CONFIG_S_FEATURES_OK;
@@ -98,185 +191,458 @@ virtio_disk_init(int n)
 
   *R(n, VIRTIO_MMIO_GUEST_PAGE_SIZE) = PGSIZE;
 
-  // initialize queue 0.
-  *R(n, VIRTIO_MMIO_QUEUE_SEL) = 0;
-  uint32 max = *R(n, VIRTIO_MMIO_QUEUE_NUM_MAX);
-  if(max == 0)
-    panic("virtio disk has no queue 0");
-  if(max < NUM)
-    panic("virtio disk max queue too short");
-  *R(n, VIRTIO_MMIO_QUEUE_NUM) = NUM;
-  memset(disk[n].pages, 0, sizeof(disk[n].pages));
-  *R(n, VIRTIO_MMIO_QUEUE_PFN) = ((uint64)disk[n].pages) >> PGSHIFT;
-
-  // desc = pages -- num * VRingDesc
-  // avail = pages + 0x40 -- 2 * uint16, then num * uint16
-  // used = pages + 4096 -- 2 * uint16, then num * vRingUsedElem
-
-  disk[n].desc = (struct VRingDesc *) disk[n].pages;
-  disk[n].avail = (uint16*)(((char*)disk[n].desc) + NUM*sizeof(struct VRingDesc));
-  disk[n].used = (struct UsedArea *) (disk[n].pages + PGSIZE);
-
-  for(int i = 0; i < NUM; i++)
-    disk[n].free[i] = 1;
+  for(int q = 0; q < disk[n].nvq; q++)
+    initvq(n, q);
 
   disk[n].init = 1;
   // plic.c and trap.c arrange for interrupts from VIRTIO0_IRQ.
+  // the device has one interrupt for all its queues.
+}
+
+// how many queues disk n has; iosched.c keeps a request
+// queue for each.
+int
+virtio_disk_nqueue(int n)
+{
+  return disk[n].nvq;
 }
 
-// find a free descriptor, mark it non-free, return its index.
+// take a descriptor off the free list, mark it non-free,
+// and return its index; or -1 if none is free.
 static int
-alloc_desc(int n)
+alloc_desc(struct virtq *vq)
 {
-  for(int i = 0; i < NUM; i++){
-    if(disk[n].free[i]){
-      disk[n].free[i] = 0;
-      return i;
-    }
-  }
-  return -1;
+  int i;
+
+  if(vq->nfree == 0)
+    return -1;
+  i = vq->freehead;
+  vq->freehead = vq->desc[i].next;
+  vq->free[i] = 0;
+  vq->nfree--;
+  return i;
 }
 
 // mark a descriptor as free.
 static void
-free_desc(int n, int i)
+free_desc(struct virtq *vq, int i)
 {
-  if(i >= NUM)
+  if(i >= vq->num)
     panic("virtio_disk_intr 1");
-  if(disk[n].free[i])
+  if(vq->free[i])
     panic("virtio_disk_intr 2");
-  disk[n].desc[i].addr = 0;
-  disk[n].free[i] = 1;
-  wakeup(&disk[n].free[0]);
+  vq->desc[i].addr = 0;
+  vq->desc[i].next = vq->freehead;
+  vq->freehead = i;
+  vq->free[i] = 1;
+  vq->nfree++;
 }
 
 // free a chain of descriptors.
 static void
-free_chain(int n, int i)
+free_chain(struct virtq *vq, int i)
 {
+  int flags, next;
+
   while(1){
-    free_desc(n, i);
-    if(disk[n].desc[i].flags & VRING_DESC_F_NEXT)
-      i = disk[n].desc[i].next;
+    // free_desc() reuses next.
+    flags = vq->desc[i].flags;
+    next = vq->desc[i].next;
+    free_desc(vq, i);
+    if(flags & VRING_DESC_F_NEXT)
+      i = next;
     else
       break;
   }
 }
 
+// has an index moved from old to new past event? from the
+// virtio spec's vring_need_event().
 static int
-alloc3_desc(int n, int *idx)
+need_event(uint16 event, uint16 new, uint16 old)
 {
-  for(int i = 0; i < 3; i++){
-    idx[i] = alloc_desc(n);
-    if(idx[i] < 0){
-      for(int j = 0; j < i; j++)
-        free_desc(n, idx[j]);
-      return -1;
-    }
+  return (uint16)(new - event - 1) < (uint16)(new - old);
+}
+
+// fill in the descriptors for a request for nb bufs starting
+// at b: d[first] for hdr, then the descriptors along the
+// chain of d[].next, already set, for the data and status.
+static void
+fill(struct VRingDesc *d, int first, struct virtio_blk_outhdr *hdr,
+     char *status, struct buf *b, int nb, int write)
+{
+  struct VRingDesc *dd;
+  int i;
+
+  dd = &d[first];
+  dd->addr = (uint64) hdr;
+  dd->len = sizeof(*hdr);
+  dd->flags = VRING_DESC_F_NEXT;
+
+  for(i = 0; i < nb; i++, b = b->qnext){
+    dd = &d[dd->next];
+    dd->addr = (uint64) b->data;
+    dd->len = BSIZE;
+    if(write)
+      dd->flags = 0; // device reads b->data
+    else
+      dd->flags = VRING_DESC_F_WRITE; // device writes b->data
+    dd->flags |= VRING_DESC_F_NEXT;
   }
-  return 0;
+
+  dd = &d[dd->next];
+  *status = 0;
+  dd->addr = (uint64) status;
+  dd->len = 1;
+  dd->flags = VRING_DESC_F_WRITE; // device writes the status
 }
 
-void
-virtio_disk_rw(int n, struct buf *b, int write)
+// make the request at head available to the device, on
+// queue q of disk n. caller must hold the queue's lock.
+static void
+submit(int n, int q, int head)
 {
-  uint64 sector = b->blockno * (BSIZE / 512);
+  struct virtq *vq = &disk[n].vq[q];
 
-  acquire(&disk[n].vdisk_lock);
+  // avail[0] is flags
+  // avail[1] tells the device how far to look in avail[2...].
+  // avail[2...] are desc[] indices the device should process.
+  // we only tell device the first index in our chain of descriptors.
+  uint16 old = vq->avail[1];
+  vq->avail[2 + (old % vq->num)] = head;
+  __sync_synchronize();
+  vq->avail[1] = old + 1;
+  vq->ninflight++;
 
-  // the spec says that legacy block operations use three
-  // descriptors: one for type/reserved/sector, one for
-  // the data, one for a 1-byte status result.
+  // with EVENT_IDX, the device says when it wants to be told
+  // about new requests; while it's busy, it'll find them.
+  __sync_synchronize();
+  if(!disk[n].eventidx || need_event(*vq->avail_event, old + 1, old))
+    *R(n, VIRTIO_MMIO_QUEUE_NOTIFY) = q; // value is queue number
+}
 
-  // allocate the three descriptors.
-  int idx[3];
-  while(1){
-    if(alloc3_desc(n, idx) == 0) {
-      break;
-    }
-    sleep(&disk[n].free[0], &disk[n].vdisk_lock);
+// issue one request on queue q of disk n for up to nb bufs
+// holding consecutive blocks, starting with b and following
+// b->qnext: read them from disk, or write them to disk if
+// write is set. iosched.c decides what to issue. doesn't wait
+// for the request to finish; virtio_disk_intr() marks read
+// bufs valid, then clears each buf's b->disk and calls its
+// b->done, if set, and virtio_disk_wait() waits for that.
+// returns how many of the bufs the request covers, fewer
+// than nb if there aren't enough free descriptors, or 0.
+int
+virtio_disk_issue(int n, int q, struct buf *b, int nb, int write)
+{
+  struct virtq *vq = &disk[n].vq[q];
+  int i, head, prev, d;
+  struct virtio_blk_outhdr *hdr;
+
+  acquire(&vq->lock);
+
+  // the spec says that legacy block operations use a
+  // descriptor for type/reserved/sector, then descriptors
+  // for the data, then one for a 1-byte status result.
+  // with indirect descriptors, they go in a table that
+  // takes one descriptor in the ring.
+  if(nb > MAXSEG)
+    nb = MAXSEG;
+  if(!disk[n].indirect && nb > vq->nfree - 2)
+    nb = vq->nfree - 2;
+  if(nb <= 0 || vq->nfree == 0){
+    release(&vq->lock);
+    return 0;
   }
-  
-  // format the three descriptors.
-  // qemu's virtio-blk.c reads them.
-
-  struct virtio_blk_outhdr {
-    uint32 type;
-    uint32 reserved;
-    uint64 sector;
-  } buf0;
 
+  // qemu's virtio-blk.c reads the descriptors.
+  head = alloc_desc(vq);
+  hdr = &vq->info[head].hdr;
   if(write)
-    buf0.type = VIRTIO_BLK_T_OUT; // write the disk
+    hdr->type = VIRTIO_BLK_T_OUT; // write the disk
   else
-    buf0.type = VIRTIO_BLK_T_IN; // read the disk
-  buf0.reserved = 0;
-  buf0.sector = sector;
-
-  // buf0 is on a kernel stack, which is not direct mapped,
-  // thus the call to kvmpa().
-  disk[n].desc[idx[0]].addr = (uint64) kvmpa((uint64) &buf0);
-  disk[n].desc[idx[0]].len = sizeof(buf0);
-  disk[n].desc[idx[0]].flags = VRING_DESC_F_NEXT;
-  disk[n].desc[idx[0]].next = idx[1];
-
-  disk[n].desc[idx[1]].addr = (uint64) b->data;
-  disk[n].desc[idx[1]].len = BSIZE;
-  if(write)
-    disk[n].desc[idx[1]].flags = 0; // device reads b->data
-  else
-    disk[n].desc[idx[1]].flags = VRING_DESC_F_WRITE; // device writes b->data
-  disk[n].desc[idx[1]].flags |= VRING_DESC_F_NEXT;
-  disk[n].desc[idx[1]].next = idx[2];
+    hdr->type = VIRTIO_BLK_T_IN; // read the disk
+  hdr->reserved = 0;
+  hdr->sector = b->blockno * (BSIZE / 512);
+
+  // the header, status and table are in disk[n], which is
+  // direct mapped, and outlive this call.
+  if(disk[n].indirect){
+    struct VRingDesc *ind = vq->info[head].ind;
+    for(i = 0; i < nb + 1; i++)
+      ind[i].next = i + 1;
+    ind[nb + 1].next = 0;
+    fill(ind, 0, hdr, &vq->info[head].status, b, nb, write);
+    vq->desc[head].addr = (uint64) ind;
+    vq->desc[head].len = (nb + 2) * sizeof(struct VRingDesc);
+    vq->desc[head].flags = VRING_DESC_F_INDIRECT;
+    vq->desc[head].next = 0;
+  } else {
+    prev = head;
+    for(i = 0; i < nb + 1; i++){
+      d = alloc_desc(vq);
+      vq->desc[prev].next = d;
+      prev = d;
+    }
+    vq->desc[prev].next = 0;
+    fill(vq->desc, head, hdr, &vq->info[head].status, b, nb, write);
+  }
 
-  disk[n].info[idx[0]].status = 0;
-  disk[n].desc[idx[2]].addr = (uint64) &disk[n].info[idx[0]].status;
-  disk[n].desc[idx[2]].len = 1;
-  disk[n].desc[idx[2]].flags = VRING_DESC_F_WRITE; // device writes the status
-  disk[n].desc[idx[2]].next = 0;
+  // record the bufs for virtio_disk_intr().
+  vq->info[head].b = b;
+  vq->info[head].nb = nb;
+  vq->info[head].write = write;
+  submit(n, q, head);
 
-  // record struct buf for virtio_disk_intr().
-  b->disk = 1;
-  disk[n].info[idx[0]].b = b;
+  release(&vq->lock);
+  return nb;
+}
 
-  // avail[0] is flags
-  // avail[1] tells the device how far to look in avail[2...].
-  // avail[2...] are desc[] indices the device should process.
-  // we only tell device the first index in our chain of descriptors.
-  disk[n].avail[2 + (disk[n].avail[1] % NUM)] = idx[0];
-  __sync_synchronize();
-  disk[n].avail[1] = disk[n].avail[1] + 1;
+// finish the requests the device has completed on queue q
+// of disk n. returns how many there were.
+// caller must hold the queue's lock.
+static int
+complete(int n, int q)
+{
+  struct virtq *vq = &disk[n].vq[q];
+  struct buf *b, *next;
+  void (*done)(struct buf*);
+  int i, ndone = 0;
+
+  for(;;){
+    // compare whole 16-bit indices: with a deep queue, num
+    // requests may complete between interrupts.
+    while(vq->used_idx != *(volatile uint16*)&vq->used->id){
+      __sync_synchronize();
+      int id = vq->used->elems[vq->used_idx % vq->num].id;
+
+      if(vq->info[id].b == 0){
+        // a flush or discard; request() checks the status
+        // and frees the chain.
+        vq->info[id].done = 1;
+        wakeup(&vq->info[id]);
+        vq->used_idx++;
+        vq->ninflight--;
+        ndone++;
+        continue;
+      }
+
+      if(vq->info[id].status != 0)
+        panic("virtio_disk_intr status");
+
+      b = vq->info[id].b;
+      for(i = 0; i < vq->info[id].nb; i++, b = next){
+        // b may be locked and submitted again once b->disk
+        // is clear, so take what we need from it first.
+        next = b->qnext;
+        done = b->done;
+        b->done = 0;
+        if(!vq->info[id].write)
+          b->valid = 1;
+        __sync_synchronize();
+        b->disk = 0;   // disk is done with buf
+        wakeup(b);
+        if(done)
+          done(b);
+      }
+      vq->info[id].b = 0;
+      free_chain(vq, id);
+      if(vq->descwait){
+        vq->descwait = 0;
+        wakeup(&vq->descwait);
+      }
+
+      vq->used_idx++;
+      vq->ninflight--;
+      ndone++;
+    }
+    if(!disk[n].eventidx)
+      break;
 
-  *R(n, VIRTIO_MMIO_QUEUE_NOTIFY) = 0; // value is queue number
+    // coalesce: while all the I/O in flight is asynchronous,
+    // ask for the next interrupt only once 3/4 of it is done,
+    // but no later than the last of it. while a process
+    // sleeps waiting for a request, interrupt at once.
+    if(vq->nsleeping)
+      *vq->used_event = vq->used_idx;
+    else
+      *vq->used_event = vq->used_idx + vq->ninflight * 3 / 4;
+    __sync_synchronize();
+    // the device may have passed the event before seeing it.
+    if(vq->used_idx == *(volatile uint16*)&vq->used->id)
+      break;
+  }
+  return ndone;
+}
 
-  // Wait for virtio_disk_intr() to say request has finished.
-  while(b->disk == 1) {
-    sleep(b, &disk[n].vdisk_lock);
+// issue a request of the given type, for no bufs, on disk n:
+// a flush, or a discard or write-zeroes of range, and wait
+// until the disk is done. returns 0, or -1 if it failed.
+static int
+request(int n, int type, struct virtio_blk_discard_write_zeroes *range)
+{
+  struct virtq *vq;
+  int q, head, d, err;
+
+  push_off();
+  q = cpuid() % disk[n].nvq;
+  pop_off();
+  vq = &disk[n].vq[q];
+
+  acquire(&vq->lock);
+  // a header, the range if any, and the status; not worth
+  // an indirect table.
+  while(vq->nfree < 3){
+    vq->descwait = 1;
+    sleep(&vq->descwait, &vq->lock);
+  }
+  head = alloc_desc(vq);
+  vq->info[head].hdr.type = type;
+  vq->info[head].hdr.reserved = 0;
+  vq->info[head].hdr.sector = 0;
+  vq->desc[head].addr = (uint64) &vq->info[head].hdr;
+  vq->desc[head].len = sizeof(struct virtio_blk_outhdr);
+  vq->desc[head].flags = VRING_DESC_F_NEXT;
+  d = head;
+  if(range){
+    vq->info[head].range = *range;
+    vq->desc[d].next = alloc_desc(vq);
+    d = vq->desc[d].next;
+    vq->desc[d].addr = (uint64) &vq->info[head].range;
+    vq->desc[d].len = sizeof(*range);
+    vq->desc[d].flags = VRING_DESC_F_NEXT; // device reads the range
+  }
+  vq->desc[d].next = alloc_desc(vq);
+  d = vq->desc[d].next;
+  vq->info[head].status = 0;
+  vq->desc[d].addr = (uint64) &vq->info[head].status;
+  vq->desc[d].len = 1;
+  vq->desc[d].flags = VRING_DESC_F_WRITE;
+  vq->desc[d].next = 0;
+
+  vq->info[head].b = 0;
+  vq->info[head].nb = 0;
+  vq->info[head].done = 0;
+  submit(n, q, head);
+
+  // as in virtio_disk_wait().
+  vq->nsleeping++;
+  while(!vq->info[head].done){
+    complete(n, q);
+    if(!vq->info[head].done)
+      sleep(&vq->info[head], &vq->lock);
   }
+  vq->nsleeping--;
+  err = vq->info[head].status != 0 ? -1 : 0; // e.g. VIRTIO_BLK_S_UNSUPP
+  free_chain(vq, head);
+  if(vq->descwait){
+    vq->descwait = 0;
+    wakeup(&vq->descwait);
+  }
+  release(&vq->lock);
 
-  disk[n].info[idx[0]].b = 0;
-  free_chain(n, idx[0]);
+  // the freed descriptors can take queued requests.
+  iosched_kick(n, q);
+  return err;
+}
 
-  release(&disk[n].vdisk_lock);
+// tell disk n that the nblocks blocks starting at blockno
+// hold nothing of value, so that it can unmap them. waits
+// until the disk is done. returns 0, -1 if the disk failed
+// the discard, or -2 if it can't discard.
+int
+virtio_disk_discard(int n, uint blockno, uint nblocks)
+{
+  struct virtio_blk_discard_write_zeroes range;
+  uint64 sector, nsector;
+
+  if(!disk[n].discard)
+    return -2;
+
+  sector = (uint64)blockno * (BSIZE / 512);
+  nsector = (uint64)nblocks * (BSIZE / 512);
+  while(nsector > 0){
+    range.sector = sector;
+    range.num_sectors = nsector < disk[n].maxdiscard ?
+                        nsector : disk[n].maxdiscard;
+    range.flags = 0;
+    if(disk[n].discard == VIRTIO_BLK_T_WRITE_ZEROES)
+      range.flags = VIRTIO_BLK_WRITE_ZEROES_F_UNMAP;
+    if(request(n, disk[n].discard, &range) < 0)
+      return -1;
+    sector += range.num_sectors;
+    nsector -= range.num_sectors;
+  }
+  return 0;
 }
 
-void
-virtio_disk_intr(int n)
+// make every write that disk n has finished durable, once
+// this returns. without VIRTIO_BLK_F_FLUSH the disk has no
+// write cache, and finished writes are durable already.
+int
+virtio_disk_flush(int n)
 {
-  acquire(&disk[n].vdisk_lock);
+  if(!disk[n].flush)
+    return 0;
+  return request(n, VIRTIO_BLK_T_FLUSH, 0);
+}
 
-  while((disk[n].used_idx % NUM) != (disk[n].used->id % NUM)){
-    int id = disk[n].used->elems[disk[n].used_idx].id;
+// wait for the operation on b, if any, to finish. if poll
+// is set, first watch the used ring for up to POLLTIME,
+// which beats waiting for an interrupt and a wakeup when
+// the disk is quick.
+void
+virtio_disk_wait(int n, struct buf *b, int poll)
+{
+  struct virtq *vq = &disk[n].vq[b->vq];
+  uint64 t0 = *(volatile uint64*)CLINT_MTIME;
+  int ndone;
 
-    if(disk[n].info[id].status != 0)
-      panic("virtio_disk_intr status");
-    
-    disk[n].info[id].b->disk = 0;   // disk is done with buf
-    wakeup(disk[n].info[id].b);
+  // nothing in flight, as after every cache hit: don't touch
+  // the queue's lock.
+  __sync_synchronize();
+  if(*(volatile int*)&b->disk == 0)
+    return;
 
-    disk[n].used_idx = (disk[n].used_idx + 1) % NUM;
+  // volatile reads, since the loop may not otherwise call
+  // anything that makes the compiler read them again.
+  while(poll && *(volatile int*)&b->disk == 1 &&
+        *(volatile uint64*)CLINT_MTIME - t0 < POLLTIME){
+    if(*(volatile uint16*)&vq->used_idx == *(volatile uint16*)&vq->used->id)
+      continue;
+    acquire(&vq->lock);
+    ndone = complete(n, b->vq);
+    release(&vq->lock);
+    if(ndone)
+      iosched_kick(n, b->vq);
   }
 
-  release(&disk[n].vdisk_lock);
+  // complete() stops coalescing while we sleep; calling it
+  // brings used_event up to date.
+  acquire(&vq->lock);
+  vq->nsleeping++;
+  ndone = 0;
+  while(b->disk == 1){
+    ndone += complete(n, b->vq);
+    if(b->disk == 1)
+      sleep(b, &vq->lock);
+  }
+  vq->nsleeping--;
+  release(&vq->lock);
+  if(ndone)
+    iosched_kick(n, b->vq);
 }
 
+void
+virtio_disk_intr(int n)
+{
+  int q, ndone;
+
+  for(q = 0; q < disk[n].nvq; q++){
+    acquire(&disk[n].vq[q].lock);
+    ndone = complete(n, q);
+    release(&disk[n].vq[q].lock);
+
+    // the freed descriptors can take queued requests.
+    if(ndone)
+      iosched_kick(n, q);
+  }
+}
@@ -0,0 +1 @@
+#define WNOHANG   0x001  // waitpid(): return 0 if no child has exited yet
@@ -0,0 +1,30 @@
+// Show buffer cache statistics.
+//
+// usage: bcachestat
+//
+// Counts are since boot. ghost hits are misses on blocks
+// evicted recently enough to be remembered; those blocks go
+// in the main queue, which a sequential scan can't flush.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/bcachestat.h"
+#include "user/user.h"
+
+int
+main(int argc, char *argv[])
+{
+  struct bcachestat bs;
+  uint64 total;
+
+  if(bcachestat(&bs) < 0){
+    fprintf(2, "bcachestat: failed\n");
+    exit(1);
+  }
+  total = bs.hits + bs.misses;
+  printf("hits\t%l\nmisses\t%l\nhit%%\t%d\n", bs.hits, bs.misses,
+         total ? (int)(100 * bs.hits / total) : 0);
+  printf("ghost hits\t%l\nevictions\t%l\n", bs.ghosthits, bs.evictions);
+  printf("buffers\t%d (%d in, %d main)\n", bs.nbuf, bs.nin, bs.nmain);
+  exit(0);
+}
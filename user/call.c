@@ -13,5 +13,5 @@ int f(int x) {
 
 void main(void) {
   printf("%d %d\n", f(8)+1, 13);
-  exit();
+  exit(0);
 }
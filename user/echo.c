@@ -15,5 +15,5 @@ main(int argc, char *argv[])
       write(1, "\n", 1);
     }
   }
-  exit();
+  exit(0);
 }
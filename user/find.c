@@ -61,7 +61,7 @@ main(int argc, char** argv){
       //在路径path下递归搜索文件 
       find(argv[1], argv[2]);
     }
-    exit();
+    exit(0);
 }
 
 // 对ls中的fmtname，去掉了空白字符串
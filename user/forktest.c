@@ -25,24 +25,24 @@ forktest(void)
     if(pid < 0)
       break;
     if(pid == 0)
-      exit();
+      exit(0);
   }
 
   if(n == N){
     print("fork claimed to work N times!\n");
-    exit();
+    exit(1);
   }
 
   for(; n > 0; n--){
     if(wait() < 0){
       print("wait stopped early\n");
-      exit();
+      exit(1);
     }
   }
 
   if(wait() != -1){
     print("wait got too many\n");
-    exit();
+    exit(1);
   }
 
   print("fork test OK\n");
@@ -52,5 +52,5 @@ int
 main(void)
 {
   forktest();
-  exit();
+  exit(0);
 }
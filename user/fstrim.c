@@ -0,0 +1,33 @@
+// Discard the free blocks of a file system, so that the
+// disk can unmap them.
+//
+// usage: fstrim [path]
+//   path: a file on the file system (default /)
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+int
+main(int argc, char *argv[])
+{
+  char *path = "/";
+  int n;
+
+  if(argc > 2){
+    fprintf(2, "usage: fstrim [path]\n");
+    exit(1);
+  }
+  if(argc > 1)
+    path = argv[1];
+  if((n = fstrim(path)) == -2){
+    fprintf(2, "fstrim: %s: disk can't discard\n", path);
+    exit(1);
+  }
+  if(n < 0){
+    fprintf(2, "fstrim: %s: failed\n", path);
+    exit(1);
+  }
+  printf("%s: %d blocks trimmed\n", path, n);
+  exit(0);
+}
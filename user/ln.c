@@ -7,9 +7,9 @@ main(int argc, char *argv[])
 {
   if(argc != 3){
     fprintf(2, "Usage: ln old new\n");
-    exit();
+    exit(1);
   }
   if(link(argv[1], argv[2]) < 0)
     fprintf(2, "link %s %s: failed\n", argv[1], argv[2]);
-  exit();
+  exit(1);
 }
@@ -0,0 +1,43 @@
+// Show the most contended kernel locks.
+//
+// usage: lockstat [n]
+//   n: number of lock names to list (default 10)
+//
+// Counts are since boot, summed over all locks with the same
+// name. Hold times are in cycles for spinlocks, and in CLINT
+// mtime units (100ns in qemu) for sleeplocks.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/lockstat.h"
+#include "user/user.h"
+
+#define NMAX 64
+
+struct lockinfo li[NMAX];
+
+int
+main(int argc, char *argv[])
+{
+  int i, n = 10;
+
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(n <= 0 || n > NMAX){
+    fprintf(2, "usage: lockstat [n], 0 < n <= %d\n", NMAX);
+    exit(1);
+  }
+  if((n = lockstat(li, n)) < 0){
+    fprintf(2, "lockstat: not supported; build the kernel with LOCKSTAT=1\n");
+    exit(1);
+  }
+  printf("name\ttype\tacquire\tcontend\tspin\thold\tmaxhold\n");
+  for(i = 0; i < n; i++){
+    printf("%s\t%s\t%l\t%l\t%l\t%l\t%l\n", li[i].name,
+           li[i].type == LS_SLEEP ? "sleep" : "spin",
+           li[i].nacquire, li[i].ncontended, li[i].nspin,
+           li[i].nacquire ? li[i].holdtotal / li[i].nacquire : 0,
+           li[i].holdmax);
+  }
+  exit(0);
+}
@@ -23,7 +23,7 @@ main(int argc, char *argv[])
   test2();
   test3();
   test4();
-  exit();
+  exit(0);
 }
 
 void test0()
@@ -39,26 +39,26 @@ void test0()
   
   if (mount("/disk1", "/m") < 0) {
     printf("mount failed\n");
-    exit();
+    exit(1);
   }    
 
   if (stat("/m", &st) < 0) {
     printf("stat /m failed\n");
-    exit();
+    exit(1);
   }
 
   if (st.ino != 1 || minor(st.dev) != 1) {
     printf("stat wrong inum/minor %d %d\n", st.ino, minor(st.dev));
-    exit();
+    exit(1);
   }
   
   if ((fd = open("/m/README", O_RDONLY)) < 0) {
     printf("open read failed\n");
-    exit();
+    exit(1);
   }
   if (read(fd, buf, sizeof(buf)-1) != sizeof(buf)-1) {
     printf("read failed\n");
-    exit();
+    exit(1);
   }
   if (strcmp("xv6", buf) != 0) {
     printf("read failed\n", buf);
@@ -67,65 +67,65 @@ void test0()
   
   if ((fd = open("/m/a", O_CREATE|O_WRONLY)) < 0) {
     printf("open write failed\n");
-    exit();
+    exit(1);
   }
   
   if (write(fd, buf, sizeof(buf)) != sizeof(buf)) {
     printf("write failed\n");
-    exit();
+    exit(1);
   }
 
   close(fd);
 
   if (stat("/m/a", &st) < 0) {
     printf("stat /m/a failed\n");
-    exit();
+    exit(1);
   }
 
   if (minor(st.dev) != 1) {
     printf("stat wrong minor %d\n", minor(st.dev));
-    exit();
+    exit(1);
   }
 
 
   if (link("m/a", "/a") == 0) {
     printf("link m/a a succeeded\n");
-    exit();
+    exit(1);
   }
 
   if (unlink("m/a") < 0) {
     printf("unlink m/a failed\n");
-    exit();
+    exit(1);
   }
 
   if (chdir("/m") < 0) {
     printf("chdir /m failed\n");
-    exit();
+    exit(1);
   }
 
   if (stat(".", &st) < 0) {
     printf("stat . failed\n");
-    exit();
+    exit(1);
   }
 
   if (st.ino != 1 || minor(st.dev) != 1) {
     printf("stat wrong inum/minor %d %d\n", st.ino, minor(st.dev));
-    exit();
+    exit(1);
   }
 
   if (chdir("..") < 0) {
     printf("chdir .. failed\n");
-    exit();
+    exit(1);
   }
 
   if (stat(".", &st) < 0) {
     printf("stat . failed\n");
-    exit();
+    exit(1);
   }
 
   if (st.ino == 1 && minor(st.dev) == 0) {
     printf("stat wrong inum/minor %d %d\n", st.ino, minor(st.dev));
-    exit();
+    exit(1);
   }
 
   printf("test0 done\n");
@@ -141,67 +141,67 @@ void test1() {
 
   if (mount("/disk1", "/m") == 0) {
     printf("mount should fail\n");
-    exit();
+    exit(1);
   }    
 
   if (umount("/m") < 0) {
     printf("umount /m failed\n");
-    exit();
+    exit(1);
   }    
 
   if (umount("/m") == 0) {
     printf("umount /m succeeded\n");
-    exit();
+    exit(1);
   }    
 
   if (umount("/") == 0) {
     printf("umount / succeeded\n");
-    exit();
+    exit(1);
   }    
 
   if (stat("/m", &st) < 0) {
     printf("stat /m failed\n");
-    exit();
+    exit(1);
   }
 
   if (minor(st.dev) != 0) {
     printf("stat wrong inum/dev %d %d\n", st.ino, minor(st.dev));
-    exit();
+    exit(1);
   }
 
   // many mounts and umounts
   for (i = 0; i < 100; i++) {
     if (mount("/disk1", "/m") < 0) {
       printf("mount /m should succeed\n");
-      exit();
+      exit(1);
     }    
 
     if (umount("/m") < 0) {
       printf("umount /m failed\n");
-      exit();
+      exit(1);
     }
   }
 
   if (mount("/disk1", "/m") < 0) {
     printf("mount /m should succeed\n");
-    exit();
+    exit(1);
   }    
 
   if ((fd = open("/m/README", O_RDONLY)) < 0) {
     printf("open read failed\n");
-    exit();
+    exit(1);
   }
 
   if (umount("/m") == 0) {
     printf("umount /m succeeded\n");
-    exit();
+    exit(1);
   }
 
   close(fd);
   
   if (umount("/m") < 0) {
     printf("final umount failed\n");
-    exit();
+    exit(1);
   }
 
   printf("test1 done\n");
@@ -226,13 +226,13 @@ void test2() {
   
   if (mount("/disk1", "/m") < 0) {
       printf("mount failed\n");
-      exit();
+      exit(1);
   }    
 
   for (i = 0; i < NPID; i++) {
     if ((pid[i] = fork()) < 0) {
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
     if (pid[i] == 0) {
       while(1) {
@@ -245,15 +245,15 @@ void test2() {
   for (i = 0; i < NOP; i++) {
     if ((fd = open("/m/b", O_CREATE|O_WRONLY)) < 0) {
       printf("open write failed");
-      exit();
+      exit(1);
     }
     if (unlink("/m/b") < 0) {
       printf("unlink failed\n");
-      exit();
+      exit(1);
     }
     if (write(fd, buf, sizeof(buf)) != sizeof(buf)) {
       printf("write failed\n");
-      exit();
+      exit(1);
     }
     close(fd);
   }
@@ -263,7 +263,7 @@ void test2() {
   }
   if (umount("/m") < 0) {
     printf("umount failed\n");
-    exit();
+    exit(1);
   }    
 
   printf("test2 ok\n");
@@ -283,19 +283,19 @@ void test3() {
   for (i = 0; i < NPID; i++) {
     if ((pid[i] = fork()) < 0) {
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
     if (pid[i] == 0) {
       while(1) {
         if ((fd = open("/m/b", O_CREATE|O_WRONLY)) < 0) {
           printf("open write failed");
-          exit();
+          exit(1);
         }
         // may file, because fs was mounted/unmounted
         unlink("/m/b");
         if (write(fd, buf, sizeof(buf)) != sizeof(buf)) {
           printf("write failed\n");
-          exit();
+          exit(1);
         }
         close(fd);
         sleep(1);
@@ -305,7 +305,7 @@ void test3() {
   for (i = 0; i < NOP; i++) {
     if (mount("/disk1", "/m") < 0) {
       printf("mount failed\n");
-      exit();
+      exit(1);
     }    
     while (umount("/m") < 0) {
       printf("umount failed; try again %d\n", i);
@@ -327,7 +327,7 @@ test4()
   mkdir("/m");
   if (mount("/disk1", "/m") < 0) {
       printf("mount failed\n");
-      exit();
+      exit(1);
   }
   crash("/m/crashf", 1);
 }
@@ -18,7 +18,7 @@ main(int argc, char** argv ){
         printf("%d: received %s\n",getpid(), buf);
         close(child_fd[0]);
         write(child_fd[1], "pong", sizeof(buf));
-        exit();
+        exit(0);
     }
     // Parent Progress
     else{
@@ -27,7 +27,7 @@ main(int argc, char** argv ){
         close(child_fd[1]);
         read(child_fd[0], buf, sizeof(buf));
         printf("%d: received %s\n", getpid(), buf);
-        exit();
+        exit(0);
     }
     
 }
\ No newline at end of file
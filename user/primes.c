@@ -19,7 +19,7 @@ main(int argc, char** argv){
     //Child Process
     if((pid = fork()) == 0){
         process(pd);
-        exit();
+        exit(0);
     }
     //Parent Process
     else{
@@ -27,7 +27,7 @@ main(int argc, char** argv){
         generate_nums(nums);
         send_primes(pd, nums, 34);
         //sleep(10);
-        exit();
+        exit(0);
     }
     
 }
@@ -59,7 +59,7 @@ void process(int pd[]){
     close(pd[0]);
     
     if(infos_i == 0) {
-        exit();
+        exit(0);
     }
     
 
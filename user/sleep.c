@@ -10,24 +10,24 @@ main(int argc, char** argv){
     //printf("%d, %s, %s \n",argc, argv[0], argv[1]);
     if(argc == 1){
         printf("Please enter the parameters!");
-        exit();
+        exit(1);
     }
     else{
         cmd_parse parse_result;
         parse_result = parse_cmd(argc, argv);
         if(parse_result == toomany_char){
             printf("Too many args! \n");
-            exit();
+            exit(1);
         }
         else if(parse_result == wrong_char){
             printf("Cannot input alphabet, number only \n");
-            exit();
+            exit(1);
         }
         else{
             int duration = atoi(argv[duration_pos]);
             //printf("Sleeping %f", duration / 10.0);
             sleep(duration);
-            exit();
+            exit(0);
         }
         
     }
@@ -0,0 +1,89 @@
+// Show where CPU time goes, sampling getprocinfo() periodically.
+//
+// usage: top [interval [count]]
+//   interval: clock ticks between samples (default 10)
+//   count: number of samples to print (default: forever)
+//
+// %cpu, wait, csw and sys are deltas over the last interval.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/procinfo.h"
+#include "user/user.h"
+
+#define NTOP 64
+
+struct procinfo cur[NTOP], prev[NTOP];
+int ncur, nprev;
+
+char *states[] = {
+[PI_UNUSED]    "unused",
+[PI_SLEEPING]  "sleep ",
+[PI_RUNNABLE]  "runble",
+[PI_RUNNING]   "run   ",
+[PI_ZOMBIE]    "zombie"
+};
+
+// find pid's entry in the previous sample, if any.
+struct procinfo*
+lookup(int pid)
+{
+  for(int i = 0; i < nprev; i++)
+    if(prev[i].pid == pid)
+      return &prev[i];
+  return 0;
+}
+
+void
+show(int elapsed)
+{
+  struct procinfo *p, *o, zero;
+
+  memset(&zero, 0, sizeof(zero));
+  printf("\n%d processes, %d ticks\n", ncur, uptime());
+  printf("pid\tppid\tstate\tcpu\t%%cpu\twait\tcsw\tsys\tname\n");
+  for(p = cur; p < &cur[ncur]; p++){
+    if((o = lookup(p->pid)) == 0)
+      o = &zero;
+    printf("%d\t%d\t%s\t%d\t%d\t%d\t%d\t%d\t%s\n",
+           p->pid, p->ppid, states[p->state], p->lastcpu,
+           (int)(100 * (p->ru.rticks - o->ru.rticks) / elapsed),
+           (int)(p->ru.wticks - o->ru.wticks),
+           (int)(p->ru.nvcsw + p->ru.nivcsw - o->ru.nvcsw - o->ru.nivcsw),
+           (int)(p->ru.nsyscall - o->ru.nsyscall), p->name);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int interval = 10, count = -1;
+  int t0, t1;
+
+  if(argc > 1)
+    interval = atoi(argv[1]);
+  if(argc > 2)
+    count = atoi(argv[2]);
+  if(interval <= 0){
+    fprintf(2, "usage: top [interval [count]]\n");
+    exit(1);
+  }
+
+  nprev = getprocinfo(prev, NTOP);
+  t0 = uptime();
+  while(count != 0){
+    sleep(interval);
+    if((ncur = getprocinfo(cur, NTOP)) < 0){
+      fprintf(2, "top: getprocinfo failed\n");
+      exit(1);
+    }
+    t1 = uptime();
+    show(t1 > t0 ? t1 - t0 : 1);
+    memmove(prev, cur, sizeof(cur));
+    nprev = ncur;
+    t0 = t1;
+    if(count > 0)
+      count--;
+  }
+  exit(0);
+}
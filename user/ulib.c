@@ -1,6 +1,9 @@
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "kernel/fcntl.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/time.h"
 #include "user/user.h"
 
 char*
@@ -107,3 +110,52 @@ memmove(void *vdst, const void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// copy a consistent snapshot of the kernel's time page,
+// retrying if clockintr() updates it while we read.
+void
+gettimepage(struct timepage *tp)
+{
+  volatile struct timepage *kp = (struct timepage*)TIMEPAGE;
+  uint seq;
+
+  do {
+    while((seq = kp->seq) & 1)
+      ;
+    __sync_synchronize();
+    tp->ticks = kp->ticks;
+    tp->mtime = kp->mtime;
+    tp->freq = kp->freq;
+    __sync_synchronize();
+  } while(kp->seq != seq);
+  tp->seq = seq;
+}
+
+// read one of the clocks in kernel/time.h, without a system
+// call: the kernel lets user mode read the time CSR, and the
+// time page says how fast it counts. other clocks, or a
+// kernel that doesn't say, go to the kernel.
+int
+clock_gettime(int clk, struct timespec *ts)
+{
+  struct timepage tp;
+  uint64 t;
+
+  gettimepage(&tp);
+  if(clk == CLOCK_MONOTONIC && tp.freq)
+    asm volatile("rdtime %0" : "=r" (t));
+  else if(clk == CLOCK_MONOTONIC_COARSE && tp.freq)
+    t = tp.mtime;
+  else
+    return sys_clock_gettime(clk, ts);
+  ts->tv_sec = t / tp.freq;
+  ts->tv_nsec = (t % tp.freq) * 1000000000 / tp.freq;
+  return 0;
+}
+
+// clock ticks since boot, without a system call.
+int
+uptime(void)
+{
+  return ((volatile struct timepage*)TIMEPAGE)->ticks;
+}
@@ -1,10 +1,21 @@
 struct stat;
 struct rtcdate;
+struct procinfo;
+struct rusage;
+struct timespec;
+struct timepage;
+struct lockinfo;
+struct bcachestat;
 
 // system calls
 int fork(void);
-int exit(void) __attribute__((noreturn));
+int exit(int) __attribute__((noreturn));
 int wait(void);
+int waitpid(int, int*, int);
+int sched_setaffinity(int, uint64);
+int sched_getaffinity(int, uint64*);
+int getprocinfo(struct procinfo*, int);
+int getrusage(struct rusage*);
 int pipe(int*);
 int write(int, const void*, int);
 int read(int, void*, int);
@@ -15,6 +26,8 @@ int open(const char*, int);
 int mknod(const char*, short, short);
 int unlink(const char*);
 int fstat(int fd, struct stat*);
+int fsync(int);
+int sync(void);
 int link(const char*, const char*);
 int mkdir(const char*);
 int chdir(const char*);
@@ -22,7 +35,10 @@ int dup(int);
 int getpid(void);
 char* sbrk(int);
 int sleep(int);
-int uptime(void);
+int sys_clock_gettime(int, struct timespec*);
+int lockstat(struct lockinfo*, int);
+int bcachestat(struct bcachestat*);
+int fstrim(const char*);
 int ntas();
 int crash(const char*, int);
 int mount(char*, char *);
@@ -42,3 +58,6 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+void gettimepage(struct timepage*);
+int clock_gettime(int, struct timespec*);
+int uptime(void);
@@ -4,6 +4,11 @@
 #include "user/user.h"
 #include "kernel/fs.h"
 #include "kernel/fcntl.h"
+#include "kernel/wait.h"
+#include "kernel/procinfo.h"
+#include "kernel/time.h"
+#include "kernel/lockstat.h"
+#include "kernel/bcachestat.h"
 #include "kernel/syscall.h"
 #include "kernel/memlayout.h"
 #include "kernel/riscv.h"
@@ -22,19 +27,19 @@ iputtest(void)
 
   if(mkdir("iputdir") < 0){
     printf("mkdir failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("iputdir") < 0){
     printf("chdir iputdir failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("../iputdir") < 0){
     printf("unlink ../iputdir failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("/") < 0){
     printf("chdir / failed\n");
-    exit();
+    exit(1);
   }
   printf("iput test ok\n");
 }
@@ -50,22 +55,22 @@ exitiputtest(void)
   pid = fork();
   if(pid < 0){
     printf("fork failed\n");
-    exit();
+    exit(1);
   }
   if(pid == 0){
     if(mkdir("iputdir") < 0){
       printf("mkdir failed\n");
-      exit();
+      exit(1);
     }
     if(chdir("iputdir") < 0){
       printf("child chdir failed\n");
-      exit();
+      exit(1);
     }
     if(unlink("../iputdir") < 0){
       printf("unlink ../iputdir failed\n");
-      exit();
+      exit(1);
     }
-    exit();
+    exit(0);
   }
   wait();
   printf("exitiput test ok\n");
@@ -90,25 +95,25 @@ openiputtest(void)
   printf("openiput test\n");
   if(mkdir("oidir") < 0){
     printf("mkdir oidir failed\n");
-    exit();
+    exit(1);
   }
   pid = fork();
   if(pid < 0){
     printf("fork failed\n");
-    exit();
+    exit(1);
   }
   if(pid == 0){
     int fd = open("oidir", O_RDWR);
     if(fd >= 0){
       printf("open directory for write succeeded\n");
-      exit();
+      exit(1);
     }
-    exit();
+    exit(0);
   }
   sleep(1);
   if(unlink("oidir") != 0){
     printf("unlink failed\n");
-    exit();
+    exit(1);
   }
   wait();
   printf("openiput test ok\n");
@@ -125,13 +130,13 @@ opentest(void)
   fd = open("echo", 0);
   if(fd < 0){
     printf("open echo failed!\n");
-    exit();
+    exit(1);
   }
   close(fd);
   fd = open("doesnotexist", 0);
   if(fd >= 0){
     printf("open doesnotexist succeeded!\n");
-    exit();
+    exit(1);
   }
   printf("open test ok\n");
 }
@@ -149,16 +154,16 @@ writetest(void)
     printf("creat small succeeded; ok\n");
   } else {
     printf("error: creat small failed!\n");
-    exit();
+    exit(1);
   }
   for(i = 0; i < N; i++){
     if(write(fd, "aaaaaaaaaa", SZ) != SZ){
       printf("error: write aa %d new file failed\n", i);
-      exit();
+      exit(1);
     }
     if(write(fd, "bbbbbbbbbb", SZ) != SZ){
       printf("error: write bb %d new file failed\n", i);
-      exit();
+      exit(1);
     }
   }
   printf("writes ok\n");
@@ -168,20 +173,20 @@ writetest(void)
     printf("open small succeeded ok\n");
   } else {
     printf("error: open small failed!\n");
-    exit();
+    exit(1);
   }
   i = read(fd, buf, N*SZ*2);
   if(i == N*SZ*2){
     printf("read succeeded ok\n");
   } else {
     printf("read failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(unlink("small") < 0){
     printf("unlink small failed\n");
-    exit();
+    exit(1);
   }
   printf("small file test ok\n");
 }
@@ -196,14 +201,14 @@ writetest1(void)
   fd = open("big", O_CREATE|O_RDWR);
   if(fd < 0){
     printf("error: creat big failed!\n");
-    exit();
+    exit(1);
   }
 
   for(i = 0; i < MAXFILE; i++){
     ((int*)buf)[0] = i;
     if(write(fd, buf, BSIZE) != BSIZE){
       printf("error: write big file failed\n", i);
-      exit();
+      exit(1);
     }
   }
 
@@ -212,7 +217,7 @@ writetest1(void)
   fd = open("big", O_RDONLY);
   if(fd < 0){
     printf("error: open big failed!\n");
-    exit();
+    exit(1);
   }
 
   n = 0;
@@ -221,24 +226,24 @@ writetest1(void)
     if(i == 0){
       if(n == MAXFILE - 1){
         printf("read only %d blocks from big", n);
-        exit();
+        exit(1);
       }
       break;
     } else if(i != BSIZE){
       printf("read failed %d\n", i);
-      exit();
+      exit(1);
     }
     if(((int*)buf)[0] != n){
       printf("read content of block %d is %d\n",
              n, ((int*)buf)[0]);
-      exit();
+      exit(1);
     }
     n++;
   }
   close(fd);
   if(unlink("big") < 0){
     printf("unlink big failed\n");
-    exit();
+    exit(1);
   }
   printf("big files ok\n");
 }
@@ -273,22 +278,22 @@ void dirtest(void)
 
   if(mkdir("dir0") < 0){
     printf("mkdir failed\n");
-    exit();
+    exit(1);
   }
 
   if(chdir("dir0") < 0){
     printf("chdir dir0 failed\n");
-    exit();
+    exit(1);
   }
 
   if(chdir("..") < 0){
     printf("chdir .. failed\n");
-    exit();
+    exit(1);
   }
 
   if(unlink("dir0") < 0){
     printf("unlink dir0 failed\n");
-    exit();
+    exit(1);
   }
   printf("mkdir test ok\n");
 }
@@ -299,7 +304,7 @@ exectest(void)
   printf("exec test\n");
   if(exec("echo", echoargv) < 0){
     printf("exec echo failed\n");
-    exit();
+    exit(1);
   }
 }
 
@@ -314,7 +319,7 @@ pipe1(void)
   
   if(pipe(fds) != 0){
     printf("pipe() failed\n");
-    exit();
+    exit(1);
   }
   pid = fork();
   seq = 0;
@@ -325,10 +330,10 @@ pipe1(void)
         buf[i] = seq++;
       if(write(fds[1], buf, SZ) != SZ){
         printf("pipe1 oops 1\n");
-        exit();
+        exit(1);
       }
     }
-    exit();
+    exit(0);
   } else if(pid > 0){
     close(fds[1]);
     total = 0;
@@ -347,13 +352,13 @@ pipe1(void)
     }
     if(total != N * SZ){
       printf("pipe1 oops 3 total %d\n", total);
-      exit();
+      exit(1);
     }
     close(fds[0]);
     wait();
   } else {
     printf("fork() failed\n");
-    exit();
+    exit(1);
   }
   printf("pipe1 ok\n");
 }
@@ -369,7 +374,7 @@ preempt(void)
   pid1 = fork();
   if(pid1 < 0) {
     printf("fork failed");
-    exit();
+    exit(1);
   }
   if(pid1 == 0)
     for(;;)
@@ -378,7 +383,7 @@ preempt(void)
   pid2 = fork();
   if(pid2 < 0) {
     printf("fork failed\n");
-    exit();
+    exit(1);
   }
   if(pid2 == 0)
     for(;;)
@@ -388,7 +393,7 @@ preempt(void)
   pid3 = fork();
   if(pid3 < 0) {
      printf("fork failed\n");
-     exit();
+     exit(1);
   }
   if(pid3 == 0){
     close(pfds[0]);
@@ -428,20 +433,595 @@ exitwait(void)
     pid = fork();
     if(pid < 0){
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
     if(pid){
       if(wait() != pid){
         printf("wait wrong pid\n");
-        exit();
+        exit(1);
       }
     } else {
-      exit();
+      exit(0);
     }
   }
   printf("exitwait ok\n");
 }
 
+// waitpid() with a specific pid, exit status, and WNOHANG.
+void
+waitpidtest(void)
+{
+  int pid1, pid2, xstatus, fds[2];
+  char c;
+
+  printf("waitpid test\n");
+
+  if(pipe(fds) != 0){
+    printf("pipe() failed\n");
+    exit(1);
+  }
+  pid1 = fork();
+  if(pid1 < 0){
+    printf("fork failed\n");
+    exit(1);
+  }
+  if(pid1 == 0){
+    // wait for the parent's go-ahead.
+    read(fds[0], &c, 1);
+    exit(7);
+  }
+  pid2 = fork();
+  if(pid2 < 0){
+    printf("fork failed\n");
+    exit(1);
+  }
+  if(pid2 == 0)
+    exit(3);
+
+  if(waitpid(pid1, &xstatus, WNOHANG) != 0){
+    printf("waitpid WNOHANG didn't return 0\n");
+    exit(1);
+  }
+  if(waitpid(pid2, &xstatus, 0) != pid2 || xstatus != 3){
+    printf("waitpid wrong pid or status %d\n", xstatus);
+    exit(1);
+  }
+  write(fds[1], "x", 1);
+  if(waitpid(-1, &xstatus, 0) != pid1 || xstatus != 7){
+    printf("waitpid wrong pid or status %d\n", xstatus);
+    exit(1);
+  }
+  if(waitpid(-1, 0, WNOHANG) != -1){
+    printf("waitpid with no children didn't fail\n");
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  printf("waitpid ok\n");
+}
+
+// sched_setaffinity()/sched_getaffinity() on ourselves and a child.
+void
+affinitytest(void)
+{
+  uint64 mask, orig;
+  int pid, xstatus;
+
+  printf("affinity test\n");
+
+  if(sched_getaffinity(0, &orig) < 0 || (orig & 1) == 0){
+    printf("sched_getaffinity failed\n");
+    exit(1);
+  }
+  if(sched_setaffinity(0, 0) != -1){
+    printf("sched_setaffinity with empty mask succeeded\n");
+    exit(1);
+  }
+  if(sched_setaffinity(0, 1) < 0){
+    printf("sched_setaffinity failed\n");
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    // children inherit the mask.
+    if(sched_getaffinity(0, &mask) < 0 || mask != 1)
+      exit(1);
+    exit(0);
+  }
+  if(waitpid(pid, &xstatus, 0) != pid || xstatus != 0){
+    printf("child has wrong affinity\n");
+    exit(1);
+  }
+  if(sched_setaffinity(getpid(), orig) < 0 ||
+     sched_getaffinity(getpid(), &mask) < 0 || mask != orig){
+    printf("sched_setaffinity didn't restore mask\n");
+    exit(1);
+  }
+  printf("affinity ok\n");
+}
+
+// getrusage() counts our own system calls and sleeps,
+// and getprocinfo() lists us.
+void
+rusagetest(void)
+{
+  struct rusage ru0, ru1;
+  static struct procinfo pi[NPROC];
+  int i, n;
+
+  printf("rusage test\n");
+
+  if(getrusage(&ru0) < 0){
+    printf("getrusage failed\n");
+    exit(1);
+  }
+  for(i = 0; i < 10; i++)
+    getpid();
+  sleep(1);
+  if(getrusage(&ru1) < 0){
+    printf("getrusage failed\n");
+    exit(1);
+  }
+  if(ru1.nsyscall - ru0.nsyscall < 11 || ru1.nvcsw == ru0.nvcsw){
+    printf("getrusage counters didn't advance\n");
+    exit(1);
+  }
+  if((n = getprocinfo(pi, NPROC)) <= 0){
+    printf("getprocinfo failed\n");
+    exit(1);
+  }
+  for(i = 0; i < n; i++)
+    if(pi[i].pid == getpid())
+      break;
+  if(i == n || pi[i].state != PI_RUNNING){
+    printf("getprocinfo didn't list us\n");
+    exit(1);
+  }
+  printf("rusage ok\n");
+}
+
+// ping-pong over pipes between processes pinned to different
+// CPUs. each wakeup must reach an idle CPU, which should take
+// an IPI rather than waiting for that CPU's next timer tick.
+void
+ipitest(void)
+{
+  enum { N = 100 };
+  int i, pid, xstatus, t0;
+  int ping[2], pong[2];
+  uint64 mask;
+  char c;
+
+  printf("ipi test\n");
+
+  if(sched_getaffinity(0, &mask) < 0){
+    printf("sched_getaffinity failed\n");
+    exit(1);
+  }
+  if((mask & 3) != 3){
+    printf("ipi ok (need two CPUs)\n");
+    return;
+  }
+  if(pipe(ping) < 0 || pipe(pong) < 0){
+    printf("pipe failed\n");
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    sched_setaffinity(0, 2);
+    for(i = 0; i < N; i++){
+      if(read(ping[0], &c, 1) != 1 || write(pong[1], &c, 1) != 1)
+        exit(1);
+    }
+    exit(0);
+  }
+  sched_setaffinity(0, 1);
+  t0 = uptime();
+  for(i = 0; i < N; i++){
+    if(write(ping[1], "x", 1) != 1 || read(pong[0], &c, 1) != 1){
+      printf("ping-pong failed\n");
+      exit(1);
+    }
+  }
+  if(uptime() - t0 > N / 4){
+    printf("cross-CPU wakeups took %d ticks\n", uptime() - t0);
+    exit(1);
+  }
+  if(waitpid(pid, &xstatus, 0) != pid || xstatus != 0){
+    printf("child failed\n");
+    exit(1);
+  }
+  sched_setaffinity(0, mask);
+  close(ping[0]);
+  close(ping[1]);
+  close(pong[0]);
+  close(pong[1]);
+  printf("ipi ok\n");
+}
+
+// the time page and clock_gettime() agree and advance.
+void
+timetest(void)
+{
+  struct timepage tp0, tp1;
+  struct timespec ts0, ts1, coarse, sys;
+
+  printf("time test\n");
+
+  gettimepage(&tp0);
+  if(clock_gettime(CLOCK_MONOTONIC, &ts0) < 0){
+    printf("clock_gettime failed\n");
+    exit(1);
+  }
+  sleep(2);
+  gettimepage(&tp1);
+  if(clock_gettime(CLOCK_MONOTONIC, &ts1) < 0 ||
+     clock_gettime(CLOCK_MONOTONIC_COARSE, &coarse) < 0){
+    printf("clock_gettime failed\n");
+    exit(1);
+  }
+  if(tp1.ticks - tp0.ticks < 2 || tp1.mtime <= tp0.mtime || uptime() < tp1.ticks){
+    printf("time page didn't advance\n");
+    exit(1);
+  }
+  if(ts1.tv_sec * 1000000000 + ts1.tv_nsec <= ts0.tv_sec * 1000000000 + ts0.tv_nsec ||
+     coarse.tv_sec > ts1.tv_sec || ts1.tv_nsec >= 1000000000){
+    printf("clock_gettime went wrong\n");
+    exit(1);
+  }
+  // the system call reads the same counter as rdtime.
+  if(sys_clock_gettime(CLOCK_MONOTONIC, &sys) < 0 ||
+     sys.tv_sec * 1000000000 + sys.tv_nsec < ts1.tv_sec * 1000000000 + ts1.tv_nsec){
+    printf("sys_clock_gettime went wrong\n");
+    exit(1);
+  }
+  if(clock_gettime(99, &ts0) != -1){
+    printf("clock_gettime accepted a bad clock\n");
+    exit(1);
+  }
+  printf("time ok\n");
+}
+
+// lockstat() lists locks, most contended first.
+void
+lockstattest(void)
+{
+  static struct lockinfo li[8];
+  int i, n;
+
+  printf("lockstat test\n");
+
+  if((n = lockstat(li, 8)) < 0){
+    printf("lockstat ok (compiled out)\n");
+    return;
+  }
+  if(n == 0){
+    printf("lockstat listed no locks\n");
+    exit(1);
+  }
+  for(i = 0; i < n; i++){
+    if(li[i].name[0] == 0 || li[i].ncontended > li[i].nacquire ||
+       (i > 0 && li[i].ncontended > li[i-1].ncontended)){
+      printf("lockstat entry %d is wrong\n", i);
+      exit(1);
+    }
+  }
+  printf("lockstat ok\n");
+}
+
+// the buffer cache gives its memory back when a process
+// uses all of it, and still holds the right data after.
+void
+bcachetest(void)
+{
+  enum { N = 64 };
+  static char buf[BSIZE];
+  int fd, i, pid, xstatus;
+
+  printf("bcache test\n");
+
+  unlink("bcache");
+  if((fd = open("bcache", O_CREATE|O_RDWR)) < 0){
+    printf("create bcache failed\n");
+    exit(1);
+  }
+  for(i = 0; i < N; i++){
+    memset(buf, i, sizeof(buf));
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf("write bcache failed\n");
+      exit(1);
+    }
+  }
+  close(fd);
+
+  pid = fork();
+  if(pid < 0){
+    printf("fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    // take every page the kernel will give.
+    while(sbrk(PGSIZE) != (char*)0xffffffffffffffffL)
+      ;
+    exit(0);
+  }
+  if(waitpid(pid, &xstatus, 0) != pid || xstatus != 0){
+    printf("sbrk child failed\n");
+    exit(1);
+  }
+
+  if((fd = open("bcache", O_RDONLY)) < 0){
+    printf("open bcache failed\n");
+    exit(1);
+  }
+  for(i = 0; i < N; i++){
+    if(read(fd, buf, sizeof(buf)) != sizeof(buf) ||
+       buf[0] != (char)i || buf[BSIZE-1] != (char)i){
+      printf("bcache block %d wrong\n", i);
+      exit(1);
+    }
+  }
+  close(fd);
+  unlink("bcache");
+  printf("bcache ok\n");
+}
+
+// sequential reads in sizes that straddle blocks, which
+// read ahead, see the same data as reads that don't.
+void
+readaheadtest(void)
+{
+  enum { N = 80, CHUNK = 700 };
+  static char buf[BSIZE];
+  int fd, i, j, n, off;
+
+  printf("readahead test\n");
+
+  unlink("readahead");
+  if((fd = open("readahead", O_CREATE|O_RDWR)) < 0){
+    printf("create readahead failed\n");
+    exit(1);
+  }
+  for(i = 0; i < N; i++){
+    for(j = 0; j < BSIZE; j++)
+      buf[j] = i + j;
+    if(write(fd, buf, BSIZE) != BSIZE){
+      printf("write readahead failed\n");
+      exit(1);
+    }
+  }
+  close(fd);
+
+  if((fd = open("readahead", O_RDONLY)) < 0){
+    printf("open readahead failed\n");
+    exit(1);
+  }
+  for(off = 0; (n = read(fd, buf, CHUNK)) > 0; off += n){
+    for(j = 0; j < n; j++){
+      if(buf[j] != (char)((off + j) / BSIZE + (off + j) % BSIZE)){
+        printf("readahead byte %d wrong\n", off + j);
+        exit(1);
+      }
+    }
+  }
+  close(fd);
+  if(off != N * BSIZE){
+    printf("readahead read %d bytes\n", off);
+    exit(1);
+  }
+  unlink("readahead");
+  printf("readahead ok\n");
+}
+
+// fsync() and sync() commit at once; fsync() of a pipe fails.
+void
+fsynctest(void)
+{
+  int fd, fds[2];
+
+  printf("fsync test\n");
+
+  unlink("fsync");
+  if((fd = open("fsync", O_CREATE|O_RDWR)) < 0){
+    printf("create fsync failed\n");
+    exit(1);
+  }
+  if(write(fd, "hello", 5) != 5){
+    printf("write fsync failed\n");
+    exit(1);
+  }
+  if(fsync(fd) != 0 || sync() != 0){
+    printf("fsync failed\n");
+    exit(1);
+  }
+  close(fd);
+  if(pipe(fds) != 0){
+    printf("pipe failed\n");
+    exit(1);
+  }
+  if(fsync(fds[0]) != -1){
+    printf("fsync of a pipe succeeded\n");
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  unlink("fsync");
+  printf("fsync ok\n");
+}
+
+// blocks freed and allocated again in one transaction
+// mustn't be discarded when it commits, nor by fstrim().
+void
+trimtest(void)
+{
+  enum { N = 20 };
+  static char buf[BSIZE];
+  int fd, i, j, n;
+
+  printf("trim test\n");
+
+  unlink("trim0");
+  unlink("trim1");
+  if((fd = open("trim0", O_CREATE|O_RDWR)) < 0){
+    printf("create trim0 failed\n");
+    exit(1);
+  }
+  memset(buf, 'a', sizeof(buf));
+  for(i = 0; i < N; i++){
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf("write trim0 failed\n");
+      exit(1);
+    }
+  }
+  close(fd);
+  unlink("trim0");
+
+  if((fd = open("trim1", O_CREATE|O_RDWR)) < 0){
+    printf("create trim1 failed\n");
+    exit(1);
+  }
+  for(i = 0; i < N; i++){
+    memset(buf, 'b' + i, sizeof(buf));
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf("write trim1 failed\n");
+      exit(1);
+    }
+  }
+  close(fd);
+  sync();
+  if(fstrim("trim.nonexistent") != -1){
+    printf("fstrim of a nonexistent path succeeded\n");
+    exit(1);
+  }
+  if((n = fstrim("/")) == -2){
+    printf("disk can't discard; skipping fstrim check\n");
+  } else if(n <= 0){
+    printf("fstrim failed: %d\n", n);
+    exit(1);
+  }
+
+  if((fd = open("trim1", O_RDONLY)) < 0){
+    printf("open trim1 failed\n");
+    exit(1);
+  }
+  for(i = 0; i < N; i++){
+    if(read(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf("read trim1 failed\n");
+      exit(1);
+    }
+    for(j = 0; j < sizeof(buf); j++){
+      if(buf[j] != 'b' + i){
+        printf("trim1 block %d lost\n", i);
+        exit(1);
+      }
+    }
+  }
+  close(fd);
+  unlink("trim1");
+  printf("trim ok\n");
+}
+
+// bcachestat() counts hits and misses sensibly across
+// repeated scans of a file interleaved with metadata lookups.
+void
+bcachescantest(void)
+{
+  enum { N = 200 };
+  static char buf[BSIZE];
+  struct bcachestat bs0, bs1;
+  struct stat st;
+  int fd, i;
+
+  printf("bcache scan test\n");
+
+  unlink("scan");
+  if((fd = open("scan", O_CREATE|O_RDWR)) < 0){
+    printf("create scan failed\n");
+    exit(1);
+  }
+  for(i = 0; i < N; i++){
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf("write scan failed\n");
+      exit(1);
+    }
+  }
+  close(fd);
+
+  if(bcachestat(&bs0) < 0){
+    printf("bcachestat failed\n");
+    exit(1);
+  }
+  for(i = 0; i < 3; i++){
+    if(stat("README", &st) < 0){  // README's inode block gets hot
+      printf("stat README failed\n");
+      exit(1);
+    }
+    if((fd = open("scan", O_RDONLY)) < 0){
+      printf("open scan failed\n");
+      exit(1);
+    }
+    while(read(fd, buf, sizeof(buf)) > 0)
+      ;
+    close(fd);
+  }
+  if(bcachestat(&bs1) < 0){
+    printf("bcachestat failed\n");
+    exit(1);
+  }
+  if(bs1.hits <= bs0.hits || bs1.misses < bs0.misses ||
+     bs1.nin + bs1.nmain > bs1.nbuf){
+    printf("bcachestat counts wrong\n");
+    exit(1);
+  }
+  unlink("scan");
+  printf("bcache scan ok\n");
+}
+
+// several processes computing with FP registers at once,
+// each switched out often, must not see each other's values.
+void
+fptest(void)
+{
+  enum { NCHILD = 4, N = 200 };
+  int i, j, pid, xstatus;
+  double x;  // lives in a callee-saved FP register across sleep()
+
+  printf("fp test\n");
+
+  for(i = 0; i < NCHILD; i++){
+    pid = fork();
+    if(pid < 0){
+      printf("fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      x = i;
+      for(j = 0; j < N; j++){
+        x = x * 2.0 + 1.0;
+        if(j % 20 == 0)
+          sleep(1);
+        x = (x - 1.0) / 2.0;
+      }
+      exit(x == (double)i ? 0 : 1);
+    }
+  }
+  for(i = 0; i < NCHILD; i++){
+    if(waitpid(-1, &xstatus, 0) < 0 || xstatus != 0){
+      printf("fp values corrupted\n");
+      exit(1);
+    }
+  }
+  printf("fp ok\n");
+}
+
 // try to find races in the reparenting
 // code that handles a parent exiting
 // when it still has live children.
@@ -456,24 +1036,24 @@ reparent(void)
     int pid = fork();
     if(pid < 0){
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
     if(pid){
       if(wait() != pid){
         printf("wait wrong pid\n");
-        exit();
+        exit(1);
       }
     } else {
       int pid2 = fork();
       if(pid2 < 0){
         printf("fork failed\n");
         kill(master_pid);
-        exit();
+        exit(1);
       }
       if(pid2 == 0){
-        exit();
+        exit(0);
       } else {
-        exit();
+        exit(0);
       }
     }
   }
@@ -490,18 +1070,18 @@ twochildren(void)
     int pid1 = fork();
     if(pid1 < 0){
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
     if(pid1 == 0){
-      exit();
+      exit(0);
     } else {
       int pid2 = fork();
       if(pid2 < 0){
         printf("fork failed\n");
-        exit();
+        exit(1);
       }
       if(pid2 == 0){
-        exit();
+        exit(0);
       } else {
         wait();
         wait();
@@ -524,7 +1104,7 @@ forkfork(void)
     int pid = fork();
     if(pid < 0){
       printf("fork failed");
-      exit();
+      exit(1);
     }
     if(pid == 0){
       for(int j = 0; j < 200; j++){
@@ -532,14 +1112,14 @@ forkfork(void)
         if(pid1 < 0){
           printf("fork failed\n");
           kill(ppid);
-          exit();
+          exit(1);
         }
         if(pid1 == 0){
-          exit();
+          exit(0);
         }
         wait();
       }
-      exit();
+      exit(0);
     }
   }
 
@@ -560,20 +1140,20 @@ forkforkfork(void)
   int pid = fork();
   if(pid < 0){
     printf("fork failed");
-    exit();
+    exit(1);
   }
   if(pid == 0){
     while(1){
       int fd = open("stopforking", 0);
       if(fd >= 0){
-        exit();
+        exit(0);
       }
       if(fork() < 0){
         close(open("stopforking", O_CREATE|O_RDWR));
       }
     }
 
-    exit();
+    exit(0);
   }
 
   sleep(20); // two seconds
@@ -607,11 +1187,11 @@ mem(void)
     if(m1 == 0){
       printf("couldn't allocate mem?!!\n");
       kill(ppid);
-      exit();
+      exit(1);
     }
     free(m1);
     printf("mem ok\n");
-    exit();
+    exit(0);
   } else {
     wait();
   }
@@ -645,7 +1225,7 @@ sharedfd(void)
     }
   }
   if(pid == 0)
-    exit();
+    exit(0);
   else
     wait();
   close(fd);
@@ -669,7 +1249,7 @@ sharedfd(void)
     printf("sharedfd ok\n");
   } else {
     printf("sharedfd oops %d %d\n", nc, np);
-    exit();
+    exit(1);
   }
 }
 
@@ -692,24 +1272,24 @@ fourfiles(void)
     pid = fork();
     if(pid < 0){
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
 
     if(pid == 0){
       fd = open(fname, O_CREATE | O_RDWR);
       if(fd < 0){
         printf("create failed\n");
-        exit();
+        exit(1);
       }
 
       memset(buf, '0'+pi, SZ);
       for(i = 0; i < N; i++){
         if((n = write(fd, buf, SZ)) != SZ){
           printf("write failed %d\n", n);
-          exit();
+          exit(1);
         }
       }
-      exit();
+      exit(0);
     }
   }
 
@@ -725,7 +1305,7 @@ fourfiles(void)
       for(j = 0; j < n; j++){
         if(buf[j] != '0'+i){
           printf("wrong char\n");
-          exit();
+          exit(1);
         }
       }
       total += n;
@@ -733,7 +1313,7 @@ fourfiles(void)
     close(fd);
     if(total != N*SZ){
       printf("wrong length %d\n", total);
-      exit();
+      exit(1);
     }
     unlink(fname);
   }
@@ -755,7 +1335,7 @@ createdelete(void)
     pid = fork();
     if(pid < 0){
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
 
     if(pid == 0){
@@ -766,18 +1346,18 @@ createdelete(void)
         fd = open(name, O_CREATE | O_RDWR);
         if(fd < 0){
           printf("create failed\n");
-          exit();
+          exit(1);
         }
         close(fd);
         if(i > 0 && (i % 2 ) == 0){
           name[1] = '0' + (i / 2);
           if(unlink(name) < 0){
             printf("unlink failed\n");
-            exit();
+            exit(1);
           }
         }
       }
-      exit();
+      exit(0);
     }
   }
 
@@ -793,10 +1373,10 @@ createdelete(void)
       fd = open(name, 0);
       if((i == 0 || i >= N/2) && fd < 0){
         printf("oops createdelete %s didn't exist\n", name);
-        exit();
+        exit(1);
       } else if((i >= 1 && i < N/2) && fd >= 0){
         printf("oops createdelete %s did exist\n", name);
-        exit();
+        exit(1);
       }
       if(fd >= 0)
         close(fd);
@@ -825,7 +1405,7 @@ unlinkread(void)
   fd = open("unlinkread", O_CREATE | O_RDWR);
   if(fd < 0){
     printf("create unlinkread failed\n");
-    exit();
+    exit(1);
   }
   write(fd, "hello", SZ);
   close(fd);
@@ -833,11 +1413,11 @@ unlinkread(void)
   fd = open("unlinkread", O_RDWR);
   if(fd < 0){
     printf("open unlinkread failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("unlinkread") != 0){
     printf("unlink unlinkread failed\n");
-    exit();
+    exit(1);
   }
 
   fd1 = open("unlinkread", O_CREATE | O_RDWR);
@@ -846,15 +1426,15 @@ unlinkread(void)
 
   if(read(fd, buf, sizeof(buf)) != SZ){
     printf("unlinkread read failed");
-    exit();
+    exit(1);
   }
   if(buf[0] != 'h'){
     printf("unlinkread wrong data\n");
-    exit();
+    exit(1);
   }
   if(write(fd, buf, 10) != 10){
     printf("unlinkread write failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
   unlink("unlinkread");
@@ -875,50 +1455,50 @@ linktest(void)
   fd = open("lf1", O_CREATE|O_RDWR);
   if(fd < 0){
     printf("create lf1 failed\n");
-    exit();
+    exit(1);
   }
   if(write(fd, "hello", SZ) != SZ){
     printf("write lf1 failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(link("lf1", "lf2") < 0){
     printf("link lf1 lf2 failed\n");
-    exit();
+    exit(1);
   }
   unlink("lf1");
 
   if(open("lf1", 0) >= 0){
     printf("unlinked lf1 but it is still there!\n");
-    exit();
+    exit(1);
   }
 
   fd = open("lf2", 0);
   if(fd < 0){
     printf("open lf2 failed\n");
-    exit();
+    exit(1);
   }
   if(read(fd, buf, sizeof(buf)) != SZ){
     printf("read lf2 failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(link("lf2", "lf2") >= 0){
     printf("link lf2 lf2 succeeded! oops\n");
-    exit();
+    exit(1);
   }
 
   unlink("lf2");
   if(link("lf2", "lf1") >= 0){
     printf("link non-existant succeeded! oops\n");
-    exit();
+    exit(1);
   }
 
   if(link(".", "lf1") >= 0){
     printf("link . lf1 succeeded! oops\n");
-    exit();
+    exit(1);
   }
 
   printf("linktest ok\n");
@@ -952,12 +1532,12 @@ concreate(void)
       fd = open(file, O_CREATE | O_RDWR);
       if(fd < 0){
         printf("concreate create %s failed\n", file);
-        exit();
+        exit(1);
       }
       close(fd);
     }
     if(pid == 0)
-      exit();
+      exit(0);
     else
       wait();
   }
@@ -972,11 +1552,11 @@ concreate(void)
       i = de.name[1] - '0';
       if(i < 0 || i >= sizeof(fa)){
         printf("concreate weird file %s\n", de.name);
-        exit();
+        exit(1);
       }
       if(fa[i]){
         printf("concreate duplicate file %s\n", de.name);
-        exit();
+        exit(1);
       }
       fa[i] = 1;
       n++;
@@ -986,7 +1566,7 @@ concreate(void)
 
   if(n != N){
     printf("concreate not enough files in directory listing\n");
-    exit();
+    exit(1);
   }
 
   for(i = 0; i < N; i++){
@@ -994,7 +1574,7 @@ concreate(void)
     pid = fork();
     if(pid < 0){
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
     if(((i % 3) == 0 && pid == 0) ||
        ((i % 3) == 1 && pid != 0)){
@@ -1009,7 +1589,7 @@ concreate(void)
       unlink(file);
     }
     if(pid == 0)
-      exit();
+      exit(0);
     else
       wait();
   }
@@ -1030,7 +1610,7 @@ linkunlink()
   pid = fork();
   if(pid < 0){
     printf("fork failed\n");
-    exit();
+    exit(1);
   }
 
   unsigned int x = (pid ? 1 : 97);
@@ -1048,7 +1628,7 @@ linkunlink()
   if(pid)
     wait();
   else
-    exit();
+    exit(0);
 
   printf("linkunlink ok\n");
 }
@@ -1067,7 +1647,7 @@ bigdir(void)
   fd = open("bd", O_CREATE);
   if(fd < 0){
     printf("bigdir create failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
@@ -1078,7 +1658,7 @@ bigdir(void)
     name[3] = '\0';
     if(link("bd", name) != 0){
       printf("bigdir link failed\n");
-      exit();
+      exit(1);
     }
   }
 
@@ -1090,7 +1670,7 @@ bigdir(void)
     name[3] = '\0';
     if(unlink(name) != 0){
       printf("bigdir unlink failed");
-      exit();
+      exit(1);
     }
   }
 
@@ -1107,31 +1687,31 @@ subdir(void)
   unlink("ff");
   if(mkdir("dd") != 0){
     printf("subdir mkdir dd failed\n");
-    exit();
+    exit(1);
   }
 
   fd = open("dd/ff", O_CREATE | O_RDWR);
   if(fd < 0){
     printf("create dd/ff failed\n");
-    exit();
+    exit(1);
   }
   write(fd, "ff", 2);
   close(fd);
 
   if(unlink("dd") >= 0){
     printf("unlink dd (non-empty dir) succeeded!\n");
-    exit();
+    exit(1);
   }
 
   if(mkdir("/dd/dd") != 0){
     printf("subdir mkdir dd/dd failed\n");
-    exit();
+    exit(1);
   }
 
   fd = open("dd/dd/ff", O_CREATE | O_RDWR);
   if(fd < 0){
     printf("create dd/dd/ff failed\n");
-    exit();
+    exit(1);
   }
   write(fd, "FF", 2);
   close(fd);
@@ -1139,142 +1719,142 @@ subdir(void)
   fd = open("dd/dd/../ff", 0);
   if(fd < 0){
     printf("open dd/dd/../ff failed\n");
-    exit();
+    exit(1);
   }
   cc = read(fd, buf, sizeof(buf));
   if(cc != 2 || buf[0] != 'f'){
     printf("dd/dd/../ff wrong content\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(link("dd/dd/ff", "dd/dd/ffff") != 0){
     printf("link dd/dd/ff dd/dd/ffff failed\n");
-    exit();
+    exit(1);
   }
 
   if(unlink("dd/dd/ff") != 0){
     printf("unlink dd/dd/ff failed\n");
-    exit();
+    exit(1);
   }
   if(open("dd/dd/ff", O_RDONLY) >= 0){
     printf("open (unlinked) dd/dd/ff succeeded\n");
-    exit();
+    exit(1);
   }
 
   if(chdir("dd") != 0){
     printf("chdir dd failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("dd/../../dd") != 0){
     printf("chdir dd/../../dd failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("dd/../../../dd") != 0){
     printf("chdir dd/../../dd failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("./..") != 0){
     printf("chdir ./.. failed\n");
-    exit();
+    exit(1);
   }
 
   fd = open("dd/dd/ffff", 0);
   if(fd < 0){
     printf("open dd/dd/ffff failed\n");
-    exit();
+    exit(1);
   }
   if(read(fd, buf, sizeof(buf)) != 2){
     printf("read dd/dd/ffff wrong len\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(open("dd/dd/ff", O_RDONLY) >= 0){
     printf("open (unlinked) dd/dd/ff succeeded!\n");
-    exit();
+    exit(1);
   }
 
   if(open("dd/ff/ff", O_CREATE|O_RDWR) >= 0){
     printf("create dd/ff/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(open("dd/xx/ff", O_CREATE|O_RDWR) >= 0){
     printf("create dd/xx/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(open("dd", O_CREATE) >= 0){
     printf("create dd succeeded!\n");
-    exit();
+    exit(1);
   }
   if(open("dd", O_RDWR) >= 0){
     printf("open dd rdwr succeeded!\n");
-    exit();
+    exit(1);
   }
   if(open("dd", O_WRONLY) >= 0){
     printf("open dd wronly succeeded!\n");
-    exit();
+    exit(1);
   }
   if(link("dd/ff/ff", "dd/dd/xx") == 0){
     printf("link dd/ff/ff dd/dd/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(link("dd/xx/ff", "dd/dd/xx") == 0){
     printf("link dd/xx/ff dd/dd/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(link("dd/ff", "dd/dd/ffff") == 0){
     printf("link dd/ff dd/dd/ffff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("dd/ff/ff") == 0){
     printf("mkdir dd/ff/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("dd/xx/ff") == 0){
     printf("mkdir dd/xx/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("dd/dd/ffff") == 0){
     printf("mkdir dd/dd/ffff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd/xx/ff") == 0){
     printf("unlink dd/xx/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd/ff/ff") == 0){
     printf("unlink dd/ff/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(chdir("dd/ff") == 0){
     printf("chdir dd/ff succeeded!\n");
-    exit();
+    exit(1);
   }
   if(chdir("dd/xx") == 0){
     printf("chdir dd/xx succeeded!\n");
-    exit();
+    exit(1);
   }
 
   if(unlink("dd/dd/ffff") != 0){
     printf("unlink dd/dd/ff failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd/ff") != 0){
     printf("unlink dd/ff failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd") == 0){
     printf("unlink non-empty dd succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd/dd") < 0){
     printf("unlink dd/dd failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("dd") < 0){
     printf("unlink dd failed\n");
-    exit();
+    exit(1);
   }
 
   printf("subdir ok\n");
@@ -1293,14 +1873,14 @@ bigwrite(void)
     fd = open("bigwrite", O_CREATE | O_RDWR);
     if(fd < 0){
       printf("cannot create bigwrite\n");
-      exit();
+      exit(1);
     }
     int i;
     for(i = 0; i < 2; i++){
       int cc = write(fd, buf, sz);
       if(cc != sz){
         printf("write(%d) ret %d\n", sz, cc);
-        exit();
+        exit(1);
       }
     }
     close(fd);
@@ -1322,13 +1902,13 @@ bigfile(void)
   fd = open("bigfile", O_CREATE | O_RDWR);
   if(fd < 0){
     printf("cannot create bigfile");
-    exit();
+    exit(1);
   }
   for(i = 0; i < N; i++){
     memset(buf, i, SZ);
     if(write(fd, buf, SZ) != SZ){
       printf("write bigfile failed\n");
-      exit();
+      exit(1);
     }
   }
   close(fd);
@@ -1336,31 +1916,31 @@ bigfile(void)
   fd = open("bigfile", 0);
   if(fd < 0){
     printf("cannot open bigfile\n");
-    exit();
+    exit(1);
   }
   total = 0;
   for(i = 0; ; i++){
     cc = read(fd, buf, SZ/2);
     if(cc < 0){
       printf("read bigfile failed\n");
-      exit();
+      exit(1);
     }
     if(cc == 0)
       break;
     if(cc != SZ/2){
       printf("short read bigfile\n");
-      exit();
+      exit(1);
     }
     if(buf[0] != i/2 || buf[SZ/2-1] != i/2){
       printf("read bigfile wrong data\n");
-      exit();
+      exit(1);
     }
     total += cc;
   }
   close(fd);
   if(total != N*SZ){
     printf("read bigfile wrong total\n");
-    exit();
+    exit(1);
   }
   unlink("bigfile");
 
@@ -1377,32 +1957,32 @@ fourteen(void)
 
   if(mkdir("12345678901234") != 0){
     printf("mkdir 12345678901234 failed\n");
-    exit();
+    exit(1);
   }
   if(mkdir("12345678901234/123456789012345") != 0){
     printf("mkdir 12345678901234/123456789012345 failed\n");
-    exit();
+    exit(1);
   }
   fd = open("123456789012345/123456789012345/123456789012345", O_CREATE);
   if(fd < 0){
     printf("create 123456789012345/123456789012345/123456789012345 failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
   fd = open("12345678901234/12345678901234/12345678901234", 0);
   if(fd < 0){
     printf("open 12345678901234/12345678901234/12345678901234 failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
   if(mkdir("12345678901234/12345678901234") == 0){
     printf("mkdir 12345678901234/12345678901234 succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("123456789012345/12345678901234") == 0){
     printf("mkdir 12345678901234/123456789012345 succeeded!\n");
-    exit();
+    exit(1);
   }
 
   printf("fourteen ok\n");
@@ -1414,35 +1994,35 @@ rmdot(void)
   printf("rmdot test\n");
   if(mkdir("dots") != 0){
     printf("mkdir dots failed\n");
-    exit();
+    exit(1);
   }
   if(chdir("dots") != 0){
     printf("chdir dots failed\n");
-    exit();
+    exit(1);
   }
   if(unlink(".") == 0){
     printf("rm . worked!\n");
-    exit();
+    exit(1);
   }
   if(unlink("..") == 0){
     printf("rm .. worked!\n");
-    exit();
+    exit(1);
   }
   if(chdir("/") != 0){
     printf("chdir / failed\n");
-    exit();
+    exit(1);
   }
   if(unlink("dots/.") == 0){
     printf("unlink dots/. worked!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dots/..") == 0){
     printf("unlink dots/.. worked!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dots") != 0){
     printf("unlink dots failed!\n");
-    exit();
+    exit(1);
   }
   printf("rmdot ok\n");
 }
@@ -1457,49 +2037,49 @@ dirfile(void)
   fd = open("dirfile", O_CREATE);
   if(fd < 0){
     printf("create dirfile failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
   if(chdir("dirfile") == 0){
     printf("chdir dirfile succeeded!\n");
-    exit();
+    exit(1);
   }
   fd = open("dirfile/xx", 0);
   if(fd >= 0){
     printf("create dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   fd = open("dirfile/xx", O_CREATE);
   if(fd >= 0){
     printf("create dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(mkdir("dirfile/xx") == 0){
     printf("mkdir dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dirfile/xx") == 0){
     printf("unlink dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(link("README", "dirfile/xx") == 0){
     printf("link to dirfile/xx succeeded!\n");
-    exit();
+    exit(1);
   }
   if(unlink("dirfile") != 0){
     printf("unlink dirfile failed!\n");
-    exit();
+    exit(1);
   }
 
   fd = open(".", O_RDWR);
   if(fd >= 0){
     printf("open . for writing succeeded!\n");
-    exit();
+    exit(1);
   }
   fd = open(".", 0);
   if(write(fd, "x", 1) > 0){
     printf("write . succeeded!\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
@@ -1517,11 +2097,11 @@ iref(void)
   for(i = 0; i < NINODE + 1; i++){
     if(mkdir("irefd") != 0){
       printf("mkdir irefd failed\n");
-      exit();
+      exit(1);
     }
     if(chdir("irefd") != 0){
       printf("chdir irefd failed\n");
-      exit();
+      exit(1);
     }
 
     mkdir("");
@@ -1555,29 +2135,29 @@ forktest(void)
     if(pid < 0)
       break;
     if(pid == 0)
-      exit();
+      exit(0);
   }
 
   if (n == 0) {
     printf("no fork at all!\n");
-    exit();
+    exit(1);
   }
 
   if(n == N){
     printf("fork claimed to work 1000 times!\n");
-    exit();
+    exit(1);
   }
 
   for(; n > 0; n--){
     if(wait() < 0){
       printf("wait stopped early\n");
-      exit();
+      exit(1);
     }
   }
 
   if(wait() != -1){
     printf("wait got too many\n");
-    exit();
+    exit(1);
   }
 
   printf("fork test OK\n");
@@ -1600,7 +2180,7 @@ sbrktest(void)
   a = sbrk(TOOMUCH);
   if(a != (char*)0xffffffffffffffffL){
     printf("sbrk(<toomuch>) returned %p\n", a);
-    exit();
+    exit(1);
   }
 
   // can one sbrk() less than a page?
@@ -1609,7 +2189,7 @@ sbrktest(void)
     b = sbrk(1);
     if(b != a){
       printf("sbrk test failed %d %x %x\n", i, a, b);
-      exit();
+      exit(1);
     }
     *b = 1;
     a = b + 1;
@@ -1617,16 +2197,16 @@ sbrktest(void)
   pid = fork();
   if(pid < 0){
     printf("sbrk test fork failed\n");
-    exit();
+    exit(1);
   }
   c = sbrk(1);
   c = sbrk(1);
   if(c != a + 1){
     printf("sbrk test failed post-fork\n");
-    exit();
+    exit(1);
   }
   if(pid == 0)
-    exit();
+    exit(0);
   wait();
 
   // can one grow address space to something big?
@@ -1635,7 +2215,7 @@ sbrktest(void)
   p = sbrk(amt);
   if (p != a) {
     printf("sbrk test failed to grow big address space; enough phys mem?\n");
-    exit();
+    exit(1);
   }
   lastaddr = (char*) (BIG-1);
   *lastaddr = 99;
@@ -1645,12 +2225,12 @@ sbrktest(void)
   c = sbrk(-PGSIZE);
   if(c == (char*)0xffffffffffffffffL){
     printf("sbrk could not deallocate\n");
-    exit();
+    exit(1);
   }
   c = sbrk(0);
   if(c != a - PGSIZE){
     printf("sbrk deallocation produced wrong address, a %x c %x\n", a, c);
-    exit();
+    exit(1);
   }
 
   // can one re-allocate that page?
@@ -1658,19 +2238,19 @@ sbrktest(void)
   c = sbrk(PGSIZE);
   if(c != a || sbrk(0) != a + PGSIZE){
     printf("sbrk re-allocation failed, a %x c %x\n", a, c);
-    exit();
+    exit(1);
   }
   if(*lastaddr == 99){
     // should be zero
     printf("sbrk de-allocation didn't really deallocate\n");
-    exit();
+    exit(1);
   }
 
   a = sbrk(0);
   c = sbrk(-(sbrk(0) - oldbrk));
   if(c != a){
     printf("sbrk downsize failed, a %x c %x\n", a, c);
-    exit();
+    exit(1);
   }
 
   // can we read the kernel's memory?
@@ -1679,12 +2259,12 @@ sbrktest(void)
     pid = fork();
     if(pid < 0){
       printf("fork failed\n");
-      exit();
+      exit(1);
     }
     if(pid == 0){
       printf("oops could read %x = %x\n", a, *a);
       kill(ppid);
-      exit();
+      exit(1);
     }
     wait();
   }
@@ -1693,7 +2273,7 @@ sbrktest(void)
   // failed allocation?
   if(pipe(fds) != 0){
     printf("pipe() failed\n");
-    exit();
+    exit(1);
   }
   for(i = 0; i < sizeof(pids)/sizeof(pids[0]); i++){
     if((pids[i] = fork()) == 0){
@@ -1718,7 +2298,7 @@ sbrktest(void)
   }
   if(c == (char*)0xffffffffffffffffL){
     printf("failed sbrk leaked memory\n");
-    exit();
+    exit(1);
   }
 
   // test running fork with the above allocated page 
@@ -1726,7 +2306,7 @@ sbrktest(void)
   pid = fork();
   if(pid < 0){
     printf("fork failed\n");
-    exit();
+    exit(1);
   }
 
   // test out of memory during sbrk
@@ -1740,7 +2320,7 @@ sbrktest(void)
     }
     printf("allocate a lot of memory succeeded %d\n", n);
     kill(ppid);
-    exit();
+    exit(1);
   }
   wait();
 
@@ -1750,11 +2330,11 @@ sbrktest(void)
   unlink("sbrk");
   if(fd < 0)  {
     printf("open sbrk failed\n");
-    exit();
+    exit(1);
   }
   if ((n = write(fd, a, 10)) < 0) {
     printf("write sbrk failed\n");
-    exit();
+    exit(1);
   }
   close(fd);
 
@@ -1762,7 +2342,7 @@ sbrktest(void)
   a = sbrk(PGSIZE);
   if(pipe((int *) a) != 0){
     printf("pipe() failed\n");
-    exit();
+    exit(1);
   } 
 
   if(sbrk(0) > oldbrk)
@@ -1784,7 +2364,7 @@ validatetest(void)
     // try to crash the kernel by passing in a bad string pointer
     if(link("nosuchfile", (char*)p) != -1){
       printf("link should not succeed\n");
-      exit();
+      exit(1);
     }
   }
 
@@ -1802,7 +2382,7 @@ bsstest(void)
   for(i = 0; i < sizeof(uninit); i++){
     if(uninit[i] != '\0'){
       printf("bss test failed\n");
-      exit();
+      exit(1);
     }
   }
   printf("bss test ok\n");
@@ -1829,16 +2409,16 @@ bigargtest(void)
     printf("bigarg test ok\n");
     fd = open("bigarg-ok", O_CREATE);
     close(fd);
-    exit();
+    exit(0);
   } else if(pid < 0){
     printf("bigargtest: fork failed\n");
-    exit();
+    exit(1);
   }
   wait();
   fd = open("bigarg-ok", 0);
   if(fd < 0){
     printf("bigarg test failed!\n");
-    exit();
+    exit(1);
   }
   close(fd);
   unlink("bigarg-ok");
@@ -1903,7 +2483,7 @@ void argptest()
   fd = open("init", O_RDONLY);
   if (fd < 0) {
     fprintf(2, "open failed\n");
-    exit();
+    exit(1);
   }
   read(fd, sbrk(0) - 1, -1);
   close(fd);
@@ -1935,10 +2515,10 @@ stacktest()
     printf("stacktest: read below stack %p\n", *sp);
     printf("stacktest: test FAILED\n");
     kill(ppid);
-    exit();
+    exit(1);
   } else if(pid < 0){
     printf("fork failed\n");
-    exit();
+    exit(1);
   }
   wait();
   printf("stack guard test ok\n");
@@ -1951,7 +2531,7 @@ main(int argc, char *argv[])
 
   if(open("usertests.ran", 0) >= 0){
     printf("already ran user tests -- rebuild fs.img\n");
-    exit();
+    exit(1);
   }
   close(open("usertests.ran", O_CREATE));
 
@@ -1988,6 +2568,18 @@ main(int argc, char *argv[])
   pipe1();
   preempt();
   exitwait();
+  waitpidtest();
+  affinitytest();
+  rusagetest();
+  fptest();
+  ipitest();
+  timetest();
+  lockstattest();
+  bcachetest();
+  readaheadtest();
+  fsynctest();
+  bcachescantest();
+  trimtest();
 
   rmdot();
   fourteen();
@@ -2002,5 +2594,5 @@ main(int argc, char *argv[])
 
   exectest();
 
-  exit();
+  exit(0);
 }
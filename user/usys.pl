@@ -6,10 +6,13 @@ print "# generated by usys.pl - do not edit\n";
 
 print "#include \"kernel/syscall.h\"\n";
 
+# entry("name", "stub") names the stub differently, for a
+# system call that a ulib function wraps.
 sub entry {
     my $name = shift;
-    print ".global $name\n";
-    print "${name}:\n";
+    my $stub = shift || $name;
+    print ".global $stub\n";
+    print "${stub}:\n";
     print " li a7, SYS_${name}\n";
     print " ecall\n";
     print " ret\n";
@@ -35,8 +38,18 @@ entry("dup");
 entry("getpid");
 entry("sbrk");
 entry("sleep");
-entry("uptime");
 entry("ntas");
 entry("crash");
 entry("mount");
 entry("umount");
+entry("waitpid");
+entry("sched_setaffinity");
+entry("sched_getaffinity");
+entry("getprocinfo");
+entry("getrusage");
+entry("clock_gettime", "sys_clock_gettime");
+entry("lockstat");
+entry("fsync");
+entry("sync");
+entry("bcachestat");
+entry("fstrim");
@@ -99,7 +99,7 @@ main(int argc, char *argv[])
     else if (argc >= 3)
     {
         printf("xargs: too many initial args, only 2 permitted! \n");
-        exit();
+        exit(1);
     }
     for (int i = 0; i < args_num; i++)
     {
@@ -117,5 +117,5 @@ main(int argc, char *argv[])
         /* code */
         wait();
     }
-    exit();
+    exit(0);
 }